@@ -0,0 +1,203 @@
+/**
+ * backtrack.c
+ *
+ * Backtracking engine, as run by bt-opt. Each cell holds one solution bit,
+ * one above its candidate bit, and cells are tried most constrained first
+ * from an indexed priority queue. All state is on the stack, so a solve
+ * allocates nothing.
+ */
+
+#include <stdint.h>
+
+#include "backtrack.h"
+#include "instr.h"
+#include "util.h"
+
+// Coordinates of a cell, pushed on the stack of cells with a tried solution
+struct cell {
+  int i;
+  int j;
+};
+
+/**
+ * Get block number (0->9 reading left-right top-bottom) from i,j coordinates
+ */
+static inline int blk_index(int i, int j) {
+  return (i / BLK_WIDTH) * BLK_WIDTH + j / BLK_WIDTH;
+}
+
+/**
+ * Priority of cell n: 9 - number of its candidates not yet used by a
+ * solved or tried cell in its row, column or block
+ */
+static inline int cell_priority(uint16_t candidates[HOUSE_SZ][HOUSE_SZ],
+    uint16_t row[HOUSE_SZ], uint16_t col[HOUSE_SZ], uint16_t blk[HOUSE_SZ], int n) {
+  int i = n / HOUSE_SZ;
+  int j = n % HOUSE_SZ;
+  uint16_t used = row[i] | col[j] | blk[blk_index(i, j)];
+  return HOUSE_SZ - bit_count((candidates[i][j] << 1) & ~used);
+}
+
+/**
+ * Update priorities of the queued peers of cell n after its value changed
+ */
+static void reprioritize(struct ipq *pq, uint16_t candidates[HOUSE_SZ][HOUSE_SZ],
+    uint16_t row[HOUSE_SZ], uint16_t col[HOUSE_SZ], uint16_t blk[HOUSE_SZ], int n) {
+  for (int k = 0; k < N_PEERS; k++) {
+    int p = peers[n][k];
+    if (ipq_contains(pq, p))
+      ipq_change_key(pq, p, cell_priority(candidates, row, col, blk, p));
+  }
+}
+
+/**
+ * Apply a basic backtracking algorithm to solve.
+ *
+ * cells: array of uint16_t representing puzzle to solve, as converted by
+ * 	backtrack_load
+ * backtracks: incremented for each cell left with no value to try
+ * @return nonzero on failure to solve
+ */
+int backtrack_solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+  uint16_t max = 1 << (HOUSE_SZ + 1);
+  uint16_t target = max - 2;  // 1's in bits 1-9
+
+  // Bitvectors of all values present in each row/column for conflict checking
+  uint16_t row[HOUSE_SZ];
+  uint16_t col[HOUSE_SZ];
+  uint16_t blk[HOUSE_SZ];
+  uint16_t candidates[HOUSE_SZ][HOUSE_SZ];
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    row[i] = 0;
+    col[i] = 0;
+    blk[i] = 0;
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      candidates[i][j] = target;
+    }
+  }
+
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      if (cells[i][j] != 1) {
+        candidates[i][j] = cells[i][j];
+        // Givens contradict each other
+        if (propagate(candidates, NULL, i, j))
+          return 1;
+      }
+    }
+  }
+
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      if (!(candidates[i][j] & (candidates[i][j] - 1))) {
+        cells[i][j] = candidates[i][j];
+        row[i] |= cells[i][j];
+        col[j] |= cells[i][j];
+        blk[blk_index(i, j)] |= cells[i][j];
+      }
+    }
+  }
+
+  // Unsolved cells keyed by i * 9 + j. Priorities track the candidates left
+  // given the current partial solution, so the most constrained cell is
+  // always tried next.
+  struct ipq pq;
+  int pq_buf[3 * N_CELLS];
+  ipq_init_buf(&pq, N_CELLS, pq_buf);
+
+  struct cell coords[N_CELLS];
+  for (int n = 0; n < N_CELLS; n++) {
+    coords[n].i = n / HOUSE_SZ;
+    coords[n].j = n % HOUSE_SZ;
+    if (cells[coords[n].i][coords[n].j] == 1)
+      ipq_insert(&pq, n, cell_priority(candidates, row, col, blk, n));
+  }
+
+  // Cells with a tried solution. Each cell is on the stack at most once.
+  struct cell *done[N_CELLS];
+  int n_done = 0;
+
+  int delta = 1;  // Direction to change n
+  while ((delta && !ipq_is_empty(&pq)) || (!delta && n_done)) {
+    struct cell *cell;
+    if (delta) {
+      cell = &coords[ipq_extract_max(&pq)];
+    } else {
+      cell = done[--n_done];
+      INSTR_POP();
+    }
+    int i = cell->i;
+    int j = cell->j;
+    int z = blk_index(i, j);
+
+    // Cell is partially solved, undo previously tried solution
+    if (cells[i][j] > 1) {
+      row[i] ^= cells[i][j];
+      col[j] ^= cells[i][j];
+      blk[z] ^= cells[i][j];
+    }
+
+    // Calculate new solution: lowest value above the current one with no
+    // conflict with existing solved cells
+    uint16_t avail = target & ~(row[i] | col[j] | blk[z]) & -(cells[i][j] << 1);
+    if (avail) {
+      cells[i][j] = bit_lowest(avail);
+      row[i] |= cells[i][j];
+      col[j] |= cells[i][j];
+      blk[z] |= cells[i][j];
+      done[n_done++] = cell;
+      INSTR_PUSH();
+      delta = 1;
+    }
+    int n = i * HOUSE_SZ + j;
+    if (!avail) {
+      cells[i][j] = 1;
+      ipq_insert(&pq, n, cell_priority(candidates, row, col, blk, n));
+      (*backtracks)++;
+      delta = 0;
+    }
+    reprioritize(&pq, candidates, row, col, blk, n);
+  }
+
+  // Check if solved
+  uint16_t solved = target;
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    solved &= row[i];
+    solved &= col[i];
+    solved &= blk[i];
+  }
+
+  if (solved != target) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Convert candidates of a freshly read puzzle to solution bits: empty cells
+ * start at 1 (0th bit) and given digit d is bit d
+ */
+void backtrack_load(uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      if (cells[i][j] & (cells[i][j] - 1)) {
+        cells[i][j] = 1;
+      } else {
+        cells[i][j] <<= 1;
+      }
+    }
+  }
+}
+
+/**
+ * Convert solution bits back to candidates, as cells_line_str expects
+ */
+void backtrack_store(uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      cells[i][j] >>= 1;
+    }
+  }
+}
+
+/* vim:set ts=2 sw=2 et: */
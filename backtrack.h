@@ -0,0 +1,19 @@
+/**
+ * backtrack.h
+ * Backtracking engine: one solution bit per cell, most constrained cell first
+ *
+ * @author: Grace-H
+ */
+
+#ifndef BACKTRACK_H
+#define BACKTRACK_H
+
+#include "util.h"
+
+void backtrack_load(uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+void backtrack_store(uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+int backtrack_solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
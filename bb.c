@@ -0,0 +1,126 @@
+/**
+ * bb.c
+ *
+ * Bitboard sudoku solver. Rather than a vector of candidates per cell, keeps
+ * one 81-bit board per digit of the cells where that digit is still a
+ * candidate. Eliminating a placed digit from its peers, finding naked and
+ * hidden singles and checking a solution are then a few 128-bit AND/OR/ANDNOT
+ * operations over every cell at once. Guesses when singles run out.
+ * The engine is in bitboard.c.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "instr.h"
+#include "pool.h"
+#include "util.h"
+
+#define IO_BUF_SZ (1 << 22) // Bytes buffered per write in line mode
+
+// Solve cells in place
+// Returns nonzero if the puzzle could not be solved
+static int solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+  instr_begin(cells);
+  int ret = bitboard_solve(cells, backtracks);
+  instr_end("bb", ret, *backtracks);
+  return ret;
+}
+
+// Write solution to stdout as one line
+// Unsolved cells are written as 0, keeping output aligned with input
+static void emit(struct pool_job *job) {
+  char solution[N_CELLS + 2];
+  cells_line_str(job->cells, solution, sizeof(solution));
+  fputs(solution, stdout);
+}
+
+static int solve_job(struct pool_job *job) {
+  int backtracks;
+  return solve(job->cells, &backtracks);
+}
+
+// Line mode: solve each puzzle in list ("-" for stdin) on n_threads threads
+// and write solutions one per line to stdout, in input order
+// Returns nonzero if any puzzle could not be solved
+static int solve_list(const char *path, int n_threads) {
+  static char out_buf[IO_BUF_SZ];
+
+  struct reader reader;
+  if (reader_open(&reader, path))
+    return 1;
+  setvbuf(stdout, out_buf, _IOFBF, IO_BUF_SZ);
+
+  int failed = pool_solve(&reader, n_threads, solve_job, emit);
+  reader_close(&reader);
+  fflush(stdout);
+  return failed;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s <puzzle file> ...\n", name);
+  fprintf(stderr, "       %s [-j threads] -l <puzzle list | ->\n", name);
+}
+
+int main(int argc, char **argv) {
+  const char *list = NULL;
+  int n_threads = 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "j:l:")) != -1) {
+    switch (opt) {
+      case 'j':
+        n_threads = atoi(optarg);
+        if (n_threads < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'l':
+        list = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  bitboard_init();
+
+  if (list)
+    return solve_list(list, n_threads);
+
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  for (int file = optind; file < argc; file++) {
+    struct reader reader;
+    if (reader_open(&reader, argv[file]))
+      return 1;
+
+    int ret;
+    uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+    while ((ret = reader_next(&reader, cells))) {
+      int backtracks = 0;
+      if (ret > 0) {
+        ret = solve(cells, &backtracks);
+        fprintf(stdout, "%d", backtracks);
+      }
+
+      // Terminate early on failure
+      if (ret) {
+        reader_close(&reader);
+        return 1;
+      }
+    }
+    reader_close(&reader);
+  }
+  return 0;
+}
+
+/* vim:set ts=2 sw=2 et: */
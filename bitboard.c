@@ -0,0 +1,216 @@
+/**
+ * bitboard.c
+ *
+ * Bitboard sudoku engine, as run by bb. Rather than a vector of candidates
+ * per cell, keeps one 81-bit board per digit of the cells where that digit
+ * is still a candidate. Eliminating a placed digit from its peers, finding naked and
+ * hidden singles and checking a solution are then a few 128-bit AND/OR/ANDNOT
+ * operations over every cell at once. Guesses when singles run out.
+ */
+
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "instr.h"
+#include "util.h"
+
+// 81 cells in a 128-bit vector register: cell n is bit n % 64 of lane n / 64
+typedef uint64_t board __attribute__((vector_size(16)));
+
+struct grid {
+  board cand[HOUSE_SZ]; // Cells where digit d + 1 is a candidate
+  board solved;         // Cells placed, by a single or a guess
+};
+
+// Boards of all cells, each cell, its peers & each house, from util's tables
+static board all_cells;
+static board cell_mask[N_CELLS];
+static board peer_mask[N_CELLS];
+static board house_mask[N_HOUSES];
+
+// Build the masks from util's tables. Must be called before bitboard_solve.
+void bitboard_init(void) {
+  for (int n = 0; n < N_CELLS; n++) {
+    cell_mask[n][n / 64] = 1ULL << (n % 64);
+    all_cells |= cell_mask[n];
+  }
+  for (int n = 0; n < N_CELLS; n++) {
+    for (int p = 0; p < N_PEERS; p++)
+      peer_mask[n] |= cell_mask[peers[n][p]];
+  }
+  for (int h = 0; h < N_HOUSES; h++) {
+    for (int k = 0; k < HOUSE_SZ; k++)
+      house_mask[h] |= cell_mask[houses[h][k]];
+  }
+}
+
+static inline int board_empty(board b) {
+  return !(b[0] | b[1]);
+}
+
+// Nonzero if exactly one cell is set
+static inline int board_single(board b) {
+  return bit_count64(b[0]) + bit_count64(b[1]) == 1;
+}
+
+// First cell set in b, which must not be empty
+static inline int board_first(board b) {
+  return b[0] ? bit_index64(b[0]) : 64 + bit_index64(b[1]);
+}
+
+// Accumulate digit boards into cells with at least one, two & three
+// candidates. Bit-sliced: each digit updates all 81 counters at once.
+static inline void count_cands(const struct grid *g, board *once, board *twice,
+    board *thrice) {
+  board zero = {0, 0};
+  *once = *twice = *thrice = zero;
+  for (int d = 0; d < HOUSE_SZ; d++) {
+    *thrice |= *twice & g->cand[d];
+    *twice |= *once & g->cand[d];
+    *once |= g->cand[d];
+  }
+}
+
+// Place digit d in cell n: clear other digits from n and d from n's peers
+// Returns -1 if d is no longer a candidate of n
+static inline int place(struct grid *g, int n, int d) {
+  board bit = cell_mask[n];
+  if (board_empty(g->cand[d] & bit))
+    return -1;
+
+  for (int e = 0; e < HOUSE_SZ; e++)
+    g->cand[e] &= ~bit;
+  g->cand[d] = (g->cand[d] | bit) & ~peer_mask[n];
+  g->solved |= bit;
+  return 0;
+}
+
+// Place naked singles, then hidden singles, until there are none left
+// Returns -1 if a cell has no candidates or a digit has no cell in a house
+static int propagate_singles(struct grid *g) {
+  for (;;) {
+    board once, twice, thrice;
+    count_cands(g, &once, &twice, &thrice);
+    if (!board_empty(all_cells & ~once))
+      return -1;
+
+    int placed = 0;
+    board singles = once & ~twice & ~g->solved;
+    for (int d = 0; d < HOUSE_SZ && !board_empty(singles); d++) {
+      board b = singles & g->cand[d];
+      singles &= ~b;
+      while (!board_empty(b)) {
+        int n = board_first(b);
+        b &= ~cell_mask[n];
+        if (place(g, n, d))
+          return -1;
+        placed = 1;
+      }
+    }
+    if (placed)
+      continue;
+
+    for (int d = 0; d < HOUSE_SZ; d++) {
+      for (int h = 0; h < N_HOUSES; h++) {
+        board b = g->cand[d] & house_mask[h];
+        if (board_empty(b))
+          return -1;
+        if (board_single(b) && board_empty(b & g->solved)) {
+          if (place(g, board_first(b), d))
+            return -1;
+          placed = 1;
+        }
+      }
+    }
+    if (!placed)
+      return 0;
+  }
+}
+
+// Check grid is solved - every cell has one candidate and each digit is in
+// each house once
+static int grid_is_solved(const struct grid *g) {
+  board once, twice, thrice;
+  count_cands(g, &once, &twice, &thrice);
+  if (!board_empty((all_cells & ~once) | twice))
+    return 0;
+
+  for (int d = 0; d < HOUSE_SZ; d++) {
+    for (int h = 0; h < N_HOUSES; h++) {
+      if (!board_single(g->cand[d] & house_mask[h]))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+// Solve by placing singles, then guessing each candidate of a cell with
+// the fewest candidates (two if there is one) on a copy of the grid
+// Returns nonzero if the grid has no solution
+static int search(struct grid *g, int *backtracks) {
+  if (propagate_singles(g))
+    return 1;
+
+  board unsolved = all_cells & ~g->solved;
+  if (board_empty(unsolved))
+    return 0;
+
+  board once, twice, thrice;
+  count_cands(g, &once, &twice, &thrice);
+  board pairs = twice & ~thrice & unsolved;
+  int n = board_first(board_empty(pairs) ? unsolved : pairs);
+
+  for (int d = 0; d < HOUSE_SZ; d++) {
+    if (board_empty(g->cand[d] & cell_mask[n]))
+      continue;
+
+    struct grid next = *g;
+    INSTR_PUSH();
+    int ret = place(&next, n, d) || search(&next, backtracks);
+    INSTR_POP();
+    if (!ret) {
+      *g = next;
+      return 0;
+    }
+    (*backtracks)++;
+  }
+  return 1;
+}
+
+// Convert candidates per cell to boards per digit & back
+static void load_grid(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct grid *g) {
+  const uint16_t *flat = &cells[0][0];
+  board zero = {0, 0};
+  g->solved = zero;
+  for (int d = 0; d < HOUSE_SZ; d++) {
+    g->cand[d] = zero;
+    for (int n = 0; n < N_CELLS; n++) {
+      if (flat[n] & (1 << d))
+        g->cand[d] |= cell_mask[n];
+    }
+  }
+}
+
+static void store_grid(const struct grid *g, uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  uint16_t *flat = &cells[0][0];
+  for (int n = 0; n < N_CELLS; n++) {
+    flat[n] = 0;
+    for (int d = 0; d < HOUSE_SZ; d++) {
+      if (!board_empty(g->cand[d] & cell_mask[n]))
+        flat[n] |= 1 << d;
+    }
+  }
+}
+
+// Solve cells in place, counting guesses that failed in backtracks
+// Returns nonzero if the puzzle could not be solved
+int bitboard_solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+  struct grid grid;
+  *backtracks = 0;
+  load_grid(cells, &grid);
+  int ret = search(&grid, backtracks) || !grid_is_solved(&grid);
+  store_grid(&grid, cells);
+  return ret;
+}
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,18 @@
+/**
+ * bitboard.h
+ * Bitboard sudoku engine: one 81-bit board of candidate cells per digit
+ *
+ * @author: Grace-H
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include "util.h"
+
+void bitboard_init(void);
+int bitboard_solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
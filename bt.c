@@ -5,6 +5,7 @@
  * @author: Grace-H
  */
 #include <stdio.h>
+#include "instr.h"
 #include "util.h"
 
 /**
@@ -58,18 +59,16 @@ int solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], uint16_t original[HOUSE_SZ]) {
 				blk[z] ^= cells[i][j];
 			}
 
-			while (cells[i][j] < max) {
-				cells[i][j] <<= 1;
-				// No conflict with existing solved cells
-				if (!(cells[i][j] & row[i] || cells[i][j] & col[j] || cells[i][j] & blk[z])) {
-					row[i] |= cells[i][j];
-					col[j] |= cells[i][j];
-					blk[z] |= cells[i][j];
-					delta = 1;
-					break;
-				}
-			}
-			if (cells[i][j] >= max) {
+			// Lowest value above the current one with no conflict with existing
+			// solved cells
+			uint16_t avail = (max - 2) & ~(row[i] | col[j] | blk[z]) & -(cells[i][j] << 1);
+			if (avail) {
+				cells[i][j] = bit_lowest(avail);
+				row[i] |= cells[i][j];
+				col[j] |= cells[i][j];
+				blk[z] |= cells[i][j];
+				delta = 1;
+			} else {
 				cells[i][j] = 1;
 				delta = -1;
 			}
@@ -99,48 +98,36 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 
-	// Initialize all cells to 0
+	// Read & parse puzzle from file
 	uint16_t cells[HOUSE_SZ][HOUSE_SZ];
 	uint16_t original[HOUSE_SZ];
-	for (int i = 0; i < HOUSE_SZ; i++) {
-		original[i] = 0;
-		for (int j = 0; j < HOUSE_SZ; j++) {
-			cells[i][j] = 1;
-		}
-	}
+	struct reader reader;
+	if (reader_open(&reader, argv[1]))
+		return 1;
 
-	// Read & parse puzzle from file
-	FILE *f = fopen(argv[1], "r");
-	if (!f) {
-		perror("open");
+	int ret = reader_next(&reader, cells);
+	reader_close(&reader);
+	if (ret < 1)
 		return 1;
-	}
+	instr_begin(cells);
 
-	char buf[HOUSE_SZ];
+	// Convert candidates to solution bits: empty cells start at 1 (0th bit)
+	// and given digit d is bit d
 	for (int i = 0; i < HOUSE_SZ; i++) {
-		int ret = fscanf(f, "%9c\n", buf);
-		if (ret < 1) {
-			perror("fscanf");
-			fclose(f);
-			return 1;
-		}
-
+		original[i] = 0;
 		for (int j = 0; j < HOUSE_SZ; j++) {
-			uint16_t d = buf[j] - '0';
-			if (d > 0 && d <= 9) {
-				cells[i][j] = 1 << d;
+			if (cells[i][j] & (cells[i][j] - 1)) {
+				cells[i][j] = 1;
+			} else {
+				cells[i][j] <<= 1;
 				original[i] |= (1 << j);
-			} else if (d != 0) {
-				fprintf(stderr, "Invalid digit: %d\n", d);
-				fclose(f);
-				return 1;
 			}
 		}
 	}
 
-	fclose(f);
-
-	return solve(cells, original);
+	ret = solve(cells, original);
+	instr_end("bt", ret, 0);
+	return ret;
 }
 
 /* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,199 @@
+/**
+ * cache.c
+ *
+ * Solution cache. Entries live in one array allocated up front, chained
+ * into a hash table by index and into a list in order of use; once the
+ * array is full, a new result takes the slot of the least recently used.
+ * Puzzles and solutions are stored packed, 41 bytes each, as in a packed
+ * corpus. One lock covers the whole cache: a lookup is short next to the
+ * canonicalization and solve around it.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "util.h"
+
+static void pack(const uint8_t grid[N_CELLS], uint8_t packed[PACKED_PUZZLE_SZ]) {
+  for (int k = 0; k < PACKED_PUZZLE_SZ; k++)
+    packed[k] = grid[2 * k] | (2 * k + 1 < N_CELLS ? grid[2 * k + 1] << 4 : 0);
+}
+
+static void unpack(const uint8_t packed[PACKED_PUZZLE_SZ], uint8_t grid[N_CELLS]) {
+  for (int n = 0; n < N_CELLS; n++)
+    grid[n] = (packed[n >> 1] >> ((n & 1) << 2)) & 0xf;
+}
+
+// FNV-1a of the packed puzzle and limit
+static uint32_t hash_key(const uint8_t key[PACKED_PUZZLE_SZ], int limit) {
+  uint32_t hash = 2166136261u;
+  for (int k = 0; k < PACKED_PUZZLE_SZ; k++)
+    hash = (hash ^ key[k]) * 16777619u;
+  return (hash ^ limit) * 16777619u;
+}
+
+// Make a cache of up to capacity results, at most CACHE_MAX
+// Returns nonzero if it could not be allocated
+int cache_init(struct cache *cache, int capacity) {
+  if (capacity < 1)
+    capacity = 1;
+  if (capacity > CACHE_MAX)
+    capacity = CACHE_MAX;
+
+  uint32_t n_buckets = 1;
+  while (n_buckets < 2 * (uint32_t) capacity)
+    n_buckets <<= 1;
+  if ((size_t) capacity > SIZE_MAX / sizeof(struct cache_entry)
+      || n_buckets > SIZE_MAX / sizeof(int))
+    return 1;
+
+  cache->entries = malloc(capacity * sizeof(struct cache_entry));
+  cache->buckets = malloc(n_buckets * sizeof(int));
+  if (!cache->entries || !cache->buckets) {
+    free(cache->entries);
+    free(cache->buckets);
+    return 1;
+  }
+  for (uint32_t b = 0; b < n_buckets; b++)
+    cache->buckets[b] = -1;
+
+  pthread_mutex_init(&cache->lock, NULL);
+  cache->capacity = capacity;
+  cache->n_entries = 0;
+  cache->bucket_mask = n_buckets - 1;
+  cache->newest = -1;
+  cache->oldest = -1;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->skipped = 0;
+  cache->evictions = 0;
+  return 0;
+}
+
+void cache_destroy(struct cache *cache) {
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->entries);
+  free(cache->buckets);
+}
+
+// Take entry e out of the list in order of use
+static void unlink_use(struct cache *cache, int e) {
+  struct cache_entry *entry = &cache->entries[e];
+  if (entry->newer >= 0)
+    cache->entries[entry->newer].older = entry->older;
+  else
+    cache->newest = entry->older;
+  if (entry->older >= 0)
+    cache->entries[entry->older].newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+}
+
+// Put entry e at the newest end of the list in order of use
+static void push_use(struct cache *cache, int e) {
+  struct cache_entry *entry = &cache->entries[e];
+  entry->newer = -1;
+  entry->older = cache->newest;
+  if (cache->newest >= 0)
+    cache->entries[cache->newest].newer = e;
+  else
+    cache->oldest = e;
+  cache->newest = e;
+}
+
+// Find the entry for key & limit, or -1
+static int find(struct cache *cache, const uint8_t key[PACKED_PUZZLE_SZ], int limit,
+    uint32_t hash) {
+  for (int e = cache->buckets[hash & cache->bucket_mask]; e >= 0; e = cache->entries[e].next) {
+    struct cache_entry *entry = &cache->entries[e];
+    if (entry->hash == hash && entry->limit == limit && !memcmp(entry->key, key, PACKED_PUZZLE_SZ))
+      return e;
+  }
+  return -1;
+}
+
+/**
+ * Look up the result for canonical puzzle canon solved with limit
+ * @return nonzero if it is not cached
+ */
+int cache_get(struct cache *cache, const uint8_t canon[N_CELLS], int limit,
+    struct cache_value *value) {
+  uint8_t key[PACKED_PUZZLE_SZ];
+  pack(canon, key);
+  uint32_t hash = hash_key(key, limit);
+
+  pthread_mutex_lock(&cache->lock);
+  int e = find(cache, key, limit, hash);
+  if (e < 0) {
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+    return 1;
+  }
+
+  struct cache_entry *entry = &cache->entries[e];
+  unpack(entry->solution, value->solution);
+  value->ret = entry->ret;
+  value->solutions = entry->solutions;
+  unlink_use(cache, e);
+  push_use(cache, e);
+  cache->hits++;
+  pthread_mutex_unlock(&cache->lock);
+  return 0;
+}
+
+/**
+ * Cache the result for canonical puzzle canon solved with limit, evicting
+ * the least recently used result if the cache is full
+ */
+void cache_put(struct cache *cache, const uint8_t canon[N_CELLS], int limit,
+    const struct cache_value *value) {
+  uint8_t key[PACKED_PUZZLE_SZ];
+  pack(canon, key);
+  uint32_t hash = hash_key(key, limit);
+
+  pthread_mutex_lock(&cache->lock);
+  // Another thread may have solved the same puzzle meanwhile
+  int e = find(cache, key, limit, hash);
+  if (e >= 0) {
+    unlink_use(cache, e);
+  } else {
+    if (cache->n_entries < cache->capacity) {
+      e = cache->n_entries++;
+    } else {
+      // Reuse the oldest entry, first taking it out of its bucket
+      e = cache->oldest;
+      unlink_use(cache, e);
+      int *link = &cache->buckets[cache->entries[e].hash & cache->bucket_mask];
+      while (*link != e)
+        link = &cache->entries[*link].next;
+      *link = cache->entries[e].next;
+      cache->evictions++;
+    }
+
+    struct cache_entry *entry = &cache->entries[e];
+    memcpy(entry->key, key, PACKED_PUZZLE_SZ);
+    entry->hash = hash;
+    entry->limit = limit;
+    entry->next = cache->buckets[hash & cache->bucket_mask];
+    cache->buckets[hash & cache->bucket_mask] = e;
+  }
+
+  struct cache_entry *entry = &cache->entries[e];
+  pack(value->solution, entry->solution);
+  entry->ret = value->ret;
+  entry->solutions = value->solutions;
+  push_use(cache, e);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+// Count a puzzle that bypassed the cache
+void cache_skip(struct cache *cache) {
+  pthread_mutex_lock(&cache->lock);
+  cache->skipped++;
+  pthread_mutex_unlock(&cache->lock);
+}
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,64 @@
+/**
+ * cache.h
+ * Solution cache: results of solves keyed by canonical puzzle (see
+ * canon.h), bounded in size and evicting the least recently used. Safe to
+ * share between threads.
+ *
+ * @author: Grace-H
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "util.h"
+
+#define CACHE_MAX (1 << 30)  // Most results a cache holds, so buckets fit 32 bits
+
+// A cached result, in the canonical frame
+struct cache_value {
+  uint8_t solution[N_CELLS];  // First solution found, if any
+  int ret;                    // sudoku_solve's return value
+  int solutions;
+};
+
+struct cache_entry {
+  uint8_t key[PACKED_PUZZLE_SZ];       // Canonical puzzle, packed as in util.h
+  uint8_t solution[PACKED_PUZZLE_SZ];
+  int8_t ret;
+  int limit;                           // Solution limit the result holds for
+  int solutions;
+  uint32_t hash;
+  int next;                            // In its bucket
+  int newer;                           // In order of use
+  int older;
+};
+
+struct cache {
+  pthread_mutex_t lock;
+  struct cache_entry *entries;
+  int capacity;
+  int n_entries;
+  int *buckets;                        // First entry of each hash, or -1
+  uint32_t bucket_mask;
+  int newest;                          // Ends of the list in order of use, or -1
+  int oldest;
+  long hits;
+  long misses;
+  long skipped;                        // Puzzles with no canonical form
+  long evictions;
+};
+
+int cache_init(struct cache *cache, int capacity);
+void cache_destroy(struct cache *cache);
+int cache_get(struct cache *cache, const uint8_t canon[N_CELLS], int limit,
+    struct cache_value *value);
+void cache_put(struct cache *cache, const uint8_t canon[N_CELLS], int limit,
+    const struct cache_value *value);
+void cache_skip(struct cache *cache);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,364 @@
+/**
+ * canon.c
+ *
+ * Canonical form of a puzzle: the least of its equivalent grids, ordered
+ * first by where the clues are and then by the clues relabeled in order of
+ * first appearance. Every arrangement of columns (2 orientations, 6 stack
+ * orders, 6^3 orders within stacks) is tried; for each, the least clue
+ * pattern puts bands and the rows within them in order of their patterns,
+ * so only row orders that tie on the pattern need their digits compared.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "canon.h"
+#include "util.h"
+
+#define N_PERMS 6  // Orders of 3 rows, columns, bands or stacks
+
+// Relabelings to try before giving up. Puzzles take a few hundred at most,
+// but grids that tie on their clue pattern in very many arrangements, such
+// as nearly empty or nearly full ones, would take up to 3.4 million.
+#define MAX_ORDERS (1 << 9)
+
+static const uint8_t perm3[N_PERMS][BLK_WIDTH] = {
+  {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0},
+};
+
+// Clue patterns are compared a stack at a time: the leading stack of every
+// row, in row order, then the middle, then the last. Each band's pattern is
+// one key holding its rows' masks, least first, split up the same way, so
+// keys of the same stacks compare as their patterns do.
+#define STACK_BITS(key, s) (((key) >> (BLK_WIDTH * BLK_WIDTH * (BLK_WIDTH - 1 - (s)))) & 0x1ff)
+
+// Best form found so far
+struct canon_search {
+  const uint8_t *grid;            // Grid in the orientation being tried
+  int transpose;
+  uint32_t pattern[BLK_WIDTH];    // Least clue pattern, as band keys
+  uint16_t masks[HOUSE_SZ];       // Its row masks
+  int have_pattern;
+  uint8_t best[N_CELLS];          // Least relabeled grid with that pattern
+  int have_best;
+  long n_orders;                  // Relabelings tried
+  struct canon_transform *transform;
+};
+
+// Relabel grid with rows & cols, keeping it if it is the least yet
+static void try_order(struct canon_search *search, const uint8_t rows[HOUSE_SZ],
+    const uint8_t cols[HOUSE_SZ]) {
+  uint8_t digits[HOUSE_SZ + 1] = {0};
+  uint8_t cand[N_CELLS];
+  int next = 1;
+  int less = !search->have_best;
+  search->n_orders++;
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    const uint8_t *row = search->grid + rows[i] * HOUSE_SZ;
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      int n = i * HOUSE_SZ + j;
+      uint8_t d = row[cols[j]];
+      if (d && !digits[d])
+        digits[d] = next++;
+      cand[n] = digits[d];
+      if (!less) {
+        if (cand[n] > search->best[n])
+          return;
+        less = cand[n] < search->best[n];
+      }
+    }
+  }
+  if (!less)
+    return;
+
+  memcpy(search->best, cand, N_CELLS);
+  search->have_best = 1;
+  struct canon_transform *transform = search->transform;
+  transform->transpose = search->transpose;
+  memcpy(transform->rows, rows, HOUSE_SZ);
+  memcpy(transform->cols, cols, HOUSE_SZ);
+  memcpy(transform->digits, digits, HOUSE_SZ + 1);
+}
+
+// Try every order of rows that gives the least pattern, given the masks of
+// the rows and the key of each band
+static void try_rows(struct canon_search *search, const uint16_t masks[HOUSE_SZ],
+    const uint32_t bands[BLK_WIDTH], const uint8_t cols[HOUSE_SZ]) {
+  uint8_t rows[HOUSE_SZ];
+  for (int bp = 0; bp < N_PERMS; bp++) {
+    // Bands in this order must match the least pattern band by band
+    const uint8_t *b = perm3[bp];
+    if (bands[b[0]] != search->pattern[0] || bands[b[1]] != search->pattern[1]
+        || bands[b[2]] != search->pattern[2])
+      continue;
+
+    // Then rows within each band, in any order that ties
+    uint8_t orders[BLK_WIDTH][N_PERMS];
+    int n_orders[BLK_WIDTH] = {0, 0, 0};
+    for (int k = 0; k < BLK_WIDTH; k++) {
+      for (int p = 0; p < N_PERMS; p++) {
+        const uint8_t *r = perm3[p];
+        const uint16_t *band = &masks[b[k] * BLK_WIDTH];
+        if (band[r[0]] == search->masks[k * BLK_WIDTH]
+            && band[r[1]] == search->masks[k * BLK_WIDTH + 1]
+            && band[r[2]] == search->masks[k * BLK_WIDTH + 2])
+          orders[k][n_orders[k]++] = p;
+      }
+    }
+
+    for (int o0 = 0; o0 < n_orders[0] && search->n_orders < MAX_ORDERS; o0++) {
+      for (int o1 = 0; o1 < n_orders[1]; o1++) {
+        for (int o2 = 0; o2 < n_orders[2]; o2++) {
+          int p[BLK_WIDTH] = {orders[0][o0], orders[1][o1], orders[2][o2]};
+          for (int i = 0; i < HOUSE_SZ; i++)
+            rows[i] = b[i / BLK_WIDTH] * BLK_WIDTH + perm3[p[i / BLK_WIDTH]][i % BLK_WIDTH];
+          try_order(search, rows, cols);
+        }
+      }
+    }
+  }
+}
+
+static inline void sort2(uint32_t *a, uint32_t *b) {
+  if (*a > *b) {
+    uint32_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+  }
+}
+
+// Key each band by its rows' masks, least first, then sort the keys into
+// pattern and the rows' masks in that order into sorted
+static void band_keys(const uint16_t masks[HOUSE_SZ], uint32_t bands[BLK_WIDTH],
+    uint32_t pattern[BLK_WIDTH]) {
+  for (int b = 0; b < BLK_WIDTH; b++) {
+    uint32_t r[BLK_WIDTH] = {masks[b * BLK_WIDTH], masks[b * BLK_WIDTH + 1],
+        masks[b * BLK_WIDTH + 2]};
+    sort2(&r[0], &r[1]);
+    sort2(&r[1], &r[2]);
+    sort2(&r[0], &r[1]);
+
+    uint32_t key = 0;
+    for (int s = 0; s < BLK_WIDTH; s++) {
+      int shift = BLK_WIDTH * (BLK_WIDTH - 1 - s);
+      for (int k = 0; k < BLK_WIDTH; k++)
+        key = key << BLK_WIDTH | ((r[k] >> shift) & 0x7);
+    }
+    bands[b] = pattern[b] = key;
+  }
+  sort2(&pattern[0], &pattern[1]);
+  sort2(&pattern[1], &pattern[2]);
+  sort2(&pattern[0], &pattern[1]);
+}
+
+// Compare patterns a and b on their first n_stacks stacks
+static int cmp_patterns(const uint32_t a[BLK_WIDTH], const uint32_t b[BLK_WIDTH], int n_stacks) {
+  for (int s = 0; s < n_stacks; s++) {
+    for (int k = 0; k < BLK_WIDTH; k++) {
+      uint32_t x = STACK_BITS(a[k], s);
+      uint32_t y = STACK_BITS(b[k], s);
+      if (x != y)
+        return x < y ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// Try every arrangement of grid's columns. The leading stacks settle the
+// start of the pattern, so arrangements are pruned a stack at a time.
+static void try_cols(struct canon_search *search, const uint8_t grid[N_CELLS],
+    const uint8_t permuted[N_PERMS][1 << BLK_WIDTH]) {
+  search->grid = grid;
+
+  // Clue pattern of each row in each stack, column 0 of the stack highest
+  uint8_t groups[HOUSE_SZ][BLK_WIDTH];
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int s = 0; s < BLK_WIDTH; s++) {
+      groups[i][s] = 0;
+      for (int k = 0; k < BLK_WIDTH; k++) {
+        if (grid[i * HOUSE_SZ + s * BLK_WIDTH + k])
+          groups[i][s] |= 1 << (BLK_WIDTH - 1 - k);
+      }
+    }
+  }
+
+  uint16_t masks[BLK_WIDTH][HOUSE_SZ];  // Rows' masks on the leading 1, 2 & 3 stacks
+  uint32_t bands[BLK_WIDTH];
+  uint32_t pattern[BLK_WIDTH];
+  uint8_t cols[HOUSE_SZ];
+  int c[BLK_WIDTH];
+  for (int sp = 0; sp < N_PERMS && search->n_orders < MAX_ORDERS; sp++) {
+    const uint8_t *stacks = perm3[sp];
+    for (c[0] = 0; c[0] < N_PERMS; c[0]++) {
+      for (int i = 0; i < HOUSE_SZ; i++)
+        masks[0][i] = permuted[c[0]][groups[i][stacks[0]]] << 6;
+      band_keys(masks[0], bands, pattern);
+      if (search->have_pattern && cmp_patterns(pattern, search->pattern, 1) > 0)
+        continue;
+
+      for (c[1] = 0; c[1] < N_PERMS; c[1]++) {
+        for (int i = 0; i < HOUSE_SZ; i++)
+          masks[1][i] = masks[0][i] | permuted[c[1]][groups[i][stacks[1]]] << 3;
+        band_keys(masks[1], bands, pattern);
+        if (search->have_pattern && cmp_patterns(pattern, search->pattern, 2) > 0)
+          continue;
+
+        for (c[2] = 0; c[2] < N_PERMS; c[2]++) {
+          for (int i = 0; i < HOUSE_SZ; i++)
+            masks[2][i] = masks[1][i] | permuted[c[2]][groups[i][stacks[2]]];
+          band_keys(masks[2], bands, pattern);
+
+          int cmp = search->have_pattern ? cmp_patterns(pattern, search->pattern, BLK_WIDTH) : -1;
+          if (cmp > 0)
+            continue;
+          if (cmp < 0) {
+            // Rows of the new pattern, read back out of its keys
+            memcpy(search->pattern, pattern, sizeof(pattern));
+            for (int i = 0; i < HOUSE_SZ; i++) {
+              search->masks[i] = 0;
+              for (int s = 0; s < BLK_WIDTH; s++) {
+                int row = STACK_BITS(pattern[i / BLK_WIDTH], s) >> (BLK_WIDTH * (BLK_WIDTH - 1 - i % BLK_WIDTH));
+                search->masks[i] |= (row & 0x7) << (BLK_WIDTH * (BLK_WIDTH - 1 - s));
+              }
+            }
+            search->have_pattern = 1;
+            search->have_best = 0;
+          }
+
+          for (int j = 0; j < HOUSE_SZ; j++)
+            cols[j] = stacks[j / BLK_WIDTH] * BLK_WIDTH + perm3[c[j / BLK_WIDTH]][j % BLK_WIDTH];
+          try_rows(search, masks[2], bands, cols);
+        }
+      }
+    }
+  }
+}
+
+// Orders of three sorted keys that leave them the same
+static int n_ties(uint32_t a, uint32_t b, uint32_t c) {
+  return a == c ? 6 : a == b || b == c ? 2 : 1;
+}
+
+// Least number of relabelings the search tries for grid. Swapping rows
+// with the same clue cells, or bands made of the same rows, leaves the
+// clue pattern as it was, so each arrangement of columns reaching the
+// least pattern is tried in every such order of rows; likewise columns.
+static long min_orders(const uint8_t grid[N_CELLS]) {
+  long orders = 1;
+  for (int transpose = 0; transpose < 2; transpose++) {
+    uint32_t masks[HOUSE_SZ];
+    for (int i = 0; i < HOUSE_SZ; i++) {
+      masks[i] = 0;
+      for (int j = 0; j < HOUSE_SZ; j++) {
+        if (grid[transpose ? j * HOUSE_SZ + i : i * HOUSE_SZ + j])
+          masks[i] |= 1 << j;
+      }
+    }
+
+    uint32_t bands[BLK_WIDTH];
+    for (int b = 0; b < BLK_WIDTH; b++) {
+      uint32_t *r = &masks[b * BLK_WIDTH];
+      sort2(&r[0], &r[1]);
+      sort2(&r[1], &r[2]);
+      sort2(&r[0], &r[1]);
+      orders *= n_ties(r[0], r[1], r[2]);
+      bands[b] = (uint32_t) r[0] << 18 | r[1] << 9 | r[2];
+    }
+    sort2(&bands[0], &bands[1]);
+    sort2(&bands[1], &bands[2]);
+    sort2(&bands[0], &bands[1]);
+    orders *= n_ties(bands[0], bands[1], bands[2]);
+  }
+  return orders;
+}
+
+/**
+ * Find the canonical form of grid, and the transform that maps grid to it.
+ * Digits grid lacks are given the labels left over in order, so the
+ * transform maps any solution of grid to a solution of canon.
+ * @return nonzero if grid has too many symmetric arrangements to search
+ */
+int canon_form(const uint8_t grid[N_CELLS], uint8_t canon[N_CELLS],
+    struct canon_transform *transform) {
+  // Give up at once on grids certain to exhaust the search
+  if (min_orders(grid) >= MAX_ORDERS)
+    return 1;
+
+  // Each order of a stack's columns, applied to its 3-bit clue pattern
+  uint8_t permuted[N_PERMS][1 << BLK_WIDTH];
+  for (int p = 0; p < N_PERMS; p++) {
+    for (int v = 0; v < 1 << BLK_WIDTH; v++) {
+      permuted[p][v] = 0;
+      for (int k = 0; k < BLK_WIDTH; k++) {
+        if (v & (1 << (BLK_WIDTH - 1 - perm3[p][k])))
+          permuted[p][v] |= 1 << (BLK_WIDTH - 1 - k);
+      }
+    }
+  }
+
+  uint8_t transposed[N_CELLS];
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++)
+      transposed[j * HOUSE_SZ + i] = grid[i * HOUSE_SZ + j];
+  }
+
+  struct canon_search search;
+  search.have_pattern = 0;
+  search.have_best = 0;
+  search.n_orders = 0;
+  search.transform = transform;
+  search.transpose = 0;
+  try_cols(&search, grid, permuted);
+  search.transpose = 1;
+  try_cols(&search, transposed, permuted);
+  if (search.n_orders >= MAX_ORDERS)
+    return 1;
+
+  int next = 1;
+  for (int d = 1; d <= HOUSE_SZ; d++)
+    next += transform->digits[d] != 0;
+  for (int d = 1; d <= HOUSE_SZ; d++) {
+    if (!transform->digits[d])
+      transform->digits[d] = next++;
+  }
+  memcpy(canon, search.best, N_CELLS);
+  return 0;
+}
+
+/**
+ * Map grid, such as a solution of the grid transform was found for, to the
+ * canonical frame
+ */
+void canon_apply(const struct canon_transform *transform, const uint8_t grid[N_CELLS],
+    uint8_t out[N_CELLS]) {
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      int r = transform->rows[i];
+      int c = transform->cols[j];
+      uint8_t d = transform->transpose ? grid[c * HOUSE_SZ + r] : grid[r * HOUSE_SZ + c];
+      out[i * HOUSE_SZ + j] = transform->digits[d];
+    }
+  }
+}
+
+/**
+ * Map canon, a grid in the canonical frame such as the solution of a
+ * canonical form, back to the frame of the grid transform was found for
+ */
+void canon_invert(const struct canon_transform *transform, const uint8_t canon[N_CELLS],
+    uint8_t out[N_CELLS]) {
+  uint8_t labels[HOUSE_SZ + 1];
+  for (int d = 0; d <= HOUSE_SZ; d++)
+    labels[transform->digits[d]] = d;
+
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      int r = transform->rows[i];
+      int c = transform->cols[j];
+      int n = transform->transpose ? c * HOUSE_SZ + r : r * HOUSE_SZ + c;
+      out[n] = labels[canon[i * HOUSE_SZ + j]];
+    }
+  }
+}
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,34 @@
+/**
+ * canon.h
+ * Canonical form of a puzzle under the sudoku symmetries: transposition,
+ * band & stack permutations, row & column permutations within them, and
+ * digit relabeling. Equivalent puzzles have the same canonical form.
+ *
+ * @author: Grace-H
+ */
+
+#ifndef CANON_H
+#define CANON_H
+
+#include <stdint.h>
+
+#include "util.h"
+
+// Map from a grid to its canonical form. Grids are 81 digits, 0 for empty.
+struct canon_transform {
+  int transpose;              // Rows & columns are swapped before the rest
+  uint8_t rows[HOUSE_SZ];     // Canonical row i is row rows[i]
+  uint8_t cols[HOUSE_SZ];     // Canonical column j is column cols[j]
+  uint8_t digits[HOUSE_SZ + 1];  // Canonical label of each digit; 0 stays 0
+};
+
+int canon_form(const uint8_t grid[N_CELLS], uint8_t canon[N_CELLS],
+    struct canon_transform *transform);
+void canon_apply(const struct canon_transform *transform, const uint8_t grid[N_CELLS],
+    uint8_t out[N_CELLS]);
+void canon_invert(const struct canon_transform *transform, const uint8_t canon[N_CELLS],
+    uint8_t out[N_CELLS]);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
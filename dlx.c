@@ -0,0 +1,167 @@
+/**
+ * dlx.c
+ *
+ * Exact cover sudoku solver using Knuth's Algorithm X with dancing links.
+ * Each of the 729 rows places one digit in one cell and covers 4 of the 324
+ * columns: the cell, and the digit in its row, column & block. A solution
+ * is a set of rows covering each column exactly once.
+ *
+ * The links are indices into one array of nodes, built once and copied per
+ * puzzle, so solving a puzzle allocates nothing. The engine is in
+ * exact_cover.c.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "exact_cover.h"
+#include "instr.h"
+#include "pool.h"
+#include "util.h"
+
+#define IO_BUF_SZ (1 << 22) // Bytes buffered per write in line mode
+
+// Solutions to count up to with --count, or 0 to solve
+static int count_limit;
+
+// Solve cells in place, or count their solutions up to count_limit
+// Returns nonzero if the puzzle could not be solved, or when counting, if
+// it does not have exactly one solution
+static int solve(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *count, int *backtracks) {
+  *backtracks = 0;
+  instr_begin(cells);
+  *count = dlx_count(cells, count_limit ? count_limit : 1, backtracks);
+  instr_end("dlx", *count < 1, *backtracks);
+  if (*count < 0)
+    *count = 0;
+  if (count_limit)
+    return *count != 1;
+  return !*count || !is_solved(cells);
+}
+
+// Write solution to stdout as one line, or when counting, the number of
+// solutions found
+// Unsolved cells are written as 0, keeping output aligned with input
+static void emit(struct pool_job *job) {
+  if (count_limit) {
+    fprintf(stdout, "%d\n", job->count);
+    return;
+  }
+
+  char solution[N_CELLS + 2];
+  cells_line_str(job->cells, solution, sizeof(solution));
+  fputs(solution, stdout);
+}
+
+static int solve_job(struct pool_job *job) {
+  int backtracks;
+  return solve(job->cells, &job->count, &backtracks);
+}
+
+// Line mode: solve each puzzle in list ("-" for stdin) on n_threads threads
+// and write solutions one per line to stdout, in input order
+// Returns nonzero if any puzzle could not be solved
+static int solve_list(const char *path, int n_threads) {
+  static char out_buf[IO_BUF_SZ];
+
+  struct reader reader;
+  if (reader_open(&reader, path))
+    return 1;
+  setvbuf(stdout, out_buf, _IOFBF, IO_BUF_SZ);
+
+  int failed = pool_solve(&reader, n_threads, solve_job, emit);
+  reader_close(&reader);
+  fflush(stdout);
+  return failed;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s <puzzle file> ...\n", name);
+  fprintf(stderr, "       %s [-j threads] -l <puzzle list | ->\n", name);
+  fprintf(stderr, "  --count[=limit]  count solutions of each puzzle up to limit (default 2)\n");
+  fprintf(stderr, "                   and print the count instead; fail unless it is 1\n");
+}
+
+int main(int argc, char **argv) {
+  const char *list = NULL;
+  int n_threads = 1;
+
+  static const struct option long_opts[] = {
+    {"count", optional_argument, NULL, 'c'},
+    {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "j:l:", long_opts, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        count_limit = optarg ? atoi(optarg) : 2;
+        if (count_limit < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'j':
+        n_threads = atoi(optarg);
+        if (n_threads < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'l':
+        list = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  dlx_init();
+
+  if (list)
+    return solve_list(list, n_threads);
+
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  int failed = 0;
+  for (int file = optind; file < argc; file++) {
+    struct reader reader;
+    if (reader_open(&reader, argv[file]))
+      return 1;
+
+    int ret;
+    uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+    while ((ret = reader_next(&reader, cells))) {
+      int count = 0;
+      int backtracks = 0;
+      if (ret > 0)
+        ret = solve(cells, &count, &backtracks);
+
+      if (count_limit) {
+        fprintf(stdout, "%d\n", count);
+        failed |= ret != 0;
+        continue;
+      }
+
+      if (ret >= 0)
+        fprintf(stdout, "%d", backtracks);
+
+      // Terminate early on failure
+      if (ret) {
+        reader_close(&reader);
+        return 1;
+      }
+    }
+    reader_close(&reader);
+  }
+  return failed;
+}
+
+/* vim:set ts=2 sw=2 et: */
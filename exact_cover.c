@@ -0,0 +1,215 @@
+/**
+ * exact_cover.c
+ *
+ * Exact cover sudoku engine, as run by dlx, using Knuth's Algorithm X with
+ * dancing links. Each of the 729 rows places one digit in one cell and
+ * covers 4 of the 324 columns: the cell, and the digit in its row, column
+ * & block. A solution is a set of rows covering each column exactly once.
+ *
+ * The links are indices into one array of nodes, built once and copied per
+ * puzzle, so solving a puzzle allocates nothing.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "exact_cover.h"
+#include "instr.h"
+#include "util.h"
+
+#define N_COLS (4 * N_CELLS)           // Constraints: cell, row, column & block
+#define N_ROWS (N_CELLS * HOUSE_SZ)    // Candidates: digit d in cell n is row n * 9 + d
+#define ROOT 0                          // Header of the column list
+#define N_NODES (1 + N_COLS + 4 * N_ROWS)
+
+struct dlx_node {
+  uint16_t left;
+  uint16_t right;
+  uint16_t up;
+  uint16_t down;
+  uint16_t col;  // Column header
+  uint16_t row;  // Row, for row nodes
+};
+
+struct dlx {
+  struct dlx_node nodes[N_NODES]; // Root, then column headers 1..324, then rows
+  uint16_t size[N_COLS + 1];      // Rows left in each column
+  uint16_t chosen[N_CELLS];       // Stack of rows in partial solution
+  int depth;
+  uint16_t first[N_CELLS];        // Rows of first solution found
+  int found;                      // Solutions found so far
+  int backtracks;                 // Rows tried that led to no solution
+};
+
+// Full matrix, built once and copied for each puzzle
+static struct dlx matrix;
+
+// Header of the n'th column of constraint k (0 cell, 1 row, 2 column, 3 block)
+static inline int col_header(int k, int n) {
+  return 1 + k * N_CELLS + n;
+}
+
+// Link node into column c, below its last row
+static void link_down(struct dlx *x, int c, int node) {
+  struct dlx_node *nodes = x->nodes;
+  nodes[node].col = c;
+  nodes[node].down = c;
+  nodes[node].up = nodes[c].up;
+  nodes[nodes[c].up].down = node;
+  nodes[c].up = node;
+  x->size[c]++;
+}
+
+// Build the full matrix. Must be called before dlx_count.
+void dlx_init(void) {
+  struct dlx_node *nodes = matrix.nodes;
+  for (int c = 0; c <= N_COLS; c++) {
+    nodes[c].left = c ? c - 1 : N_COLS;
+    nodes[c].right = c < N_COLS ? c + 1 : ROOT;
+    nodes[c].up = c;
+    nodes[c].down = c;
+    nodes[c].col = c;
+    matrix.size[c] = 0;
+  }
+
+  int node = N_COLS + 1;
+  for (int r = 0; r < N_ROWS; r++) {
+    int n = r / HOUSE_SZ;
+    int d = r % HOUSE_SZ;
+    int i = n / HOUSE_SZ;
+    int j = n % HOUSE_SZ;
+    int b = (i / BLK_WIDTH) * BLK_WIDTH + j / BLK_WIDTH;
+    int cols[4] = {
+      col_header(0, n),
+      col_header(1, i * HOUSE_SZ + d),
+      col_header(2, j * HOUSE_SZ + d),
+      col_header(3, b * HOUSE_SZ + d),
+    };
+
+    for (int k = 0; k < 4; k++) {
+      nodes[node + k].row = r;
+      nodes[node + k].left = node + (k + 3) % 4;
+      nodes[node + k].right = node + (k + 1) % 4;
+      link_down(&matrix, cols[k], node + k);
+    }
+    node += 4;
+  }
+}
+
+// Remove column c from the header list & its rows from the other columns
+static void cover(struct dlx *x, int c) {
+  struct dlx_node *nodes = x->nodes;
+  nodes[nodes[c].right].left = nodes[c].left;
+  nodes[nodes[c].left].right = nodes[c].right;
+  for (int i = nodes[c].down; i != c; i = nodes[i].down) {
+    for (int j = nodes[i].right; j != i; j = nodes[j].right) {
+      nodes[nodes[j].down].up = nodes[j].up;
+      nodes[nodes[j].up].down = nodes[j].down;
+      x->size[nodes[j].col]--;
+    }
+  }
+}
+
+// Undo cover(x, c)
+static void uncover(struct dlx *x, int c) {
+  struct dlx_node *nodes = x->nodes;
+  for (int i = nodes[c].up; i != c; i = nodes[i].up) {
+    for (int j = nodes[i].left; j != i; j = nodes[j].left) {
+      x->size[nodes[j].col]++;
+      nodes[nodes[j].down].up = j;
+      nodes[nodes[j].up].down = j;
+    }
+  }
+  nodes[nodes[c].right].left = c;
+  nodes[nodes[c].left].right = c;
+}
+
+// Add row containing node to the partial solution, covering its columns
+// Returns nonzero if one of its columns is already covered
+static int select_row(struct dlx *x, int node) {
+  struct dlx_node *nodes = x->nodes;
+  int j = node;
+  do {
+    int c = nodes[j].col;
+    if (nodes[nodes[c].left].right != c)
+      return 1;
+    cover(x, c);
+    j = nodes[j].right;
+  } while (j != node);
+
+  x->chosen[x->depth++] = nodes[node].row;
+  return 0;
+}
+
+// Search for exact covers of the remaining columns until limit solutions
+// have been found in all. The first is saved in x->first.
+// Returns the number found by this call
+static int search(struct dlx *x, int limit) {
+  struct dlx_node *nodes = x->nodes;
+  if (nodes[ROOT].right == ROOT) {
+    if (!x->found)
+      memcpy(x->first, x->chosen, x->depth * sizeof(x->chosen[0]));
+    x->found++;
+    return 1;
+  }
+
+  // Column with fewest rows
+  int c = nodes[ROOT].right;
+  for (int k = nodes[c].right; k != ROOT; k = nodes[k].right) {
+    if (x->size[k] < x->size[c])
+      c = k;
+  }
+  if (!x->size[c])
+    return 0;
+
+  int found = 0;
+  cover(x, c);
+  for (int r = nodes[c].down; r != c && x->found < limit; r = nodes[r].down) {
+    x->chosen[x->depth++] = nodes[r].row;
+    INSTR_PUSH();
+    for (int j = nodes[r].right; j != r; j = nodes[j].right)
+      cover(x, nodes[j].col);
+
+    int sub = search(x, limit);
+    if (!sub)
+      x->backtracks++;
+    found += sub;
+
+    for (int j = nodes[r].left; j != r; j = nodes[j].left)
+      uncover(x, nodes[j].col);
+    x->depth--;
+    INSTR_POP();
+  }
+  uncover(x, c);
+  return found;
+}
+
+// Count solutions of cells, up to limit, leaving the first found in cells
+// Returns the number of solutions, or -1 if the givens contradict each other
+int dlx_count(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int limit, int *backtracks) {
+  struct dlx x;
+  memcpy(&x, &matrix, sizeof(x));
+  x.depth = 0;
+  x.found = 0;
+  x.backtracks = 0;
+
+  uint16_t *flat = &cells[0][0];
+  for (int n = 0; n < N_CELLS; n++) {
+    if (flat[n] && !(flat[n] & (flat[n] - 1))) {
+      // Nodes of row n * 9 + d are in the same order as rows
+      int node = N_COLS + 1 + 4 * (n * HOUSE_SZ + bit_index(flat[n]));
+      if (select_row(&x, node))
+        return -1;
+    }
+  }
+
+  int found = search(&x, limit);
+  *backtracks = x.backtracks;
+  if (found) {
+    for (int k = 0; k < N_CELLS; k++)
+      flat[x.first[k] / HOUSE_SZ] = 1 << (x.first[k] % HOUSE_SZ);
+  }
+  return found;
+}
+
+/* vim:set ts=2 sw=2 et: */
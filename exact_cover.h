@@ -0,0 +1,18 @@
+/**
+ * exact_cover.h
+ * Exact cover sudoku engine: Algorithm X with dancing links
+ *
+ * @author: Grace-H
+ */
+
+#ifndef EXACT_COVER_H
+#define EXACT_COVER_H
+
+#include "util.h"
+
+void dlx_init(void);
+int dlx_count(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int limit, int *backtracks);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,224 @@
+/**
+ * gen.c
+ *
+ * Puzzle generator. Fills a random grid with the MRV search engine, then
+ * removes clues in random order, keeping each removal only if the puzzle
+ * still has a unique solution, until the requested number of clues is left.
+ * Puzzles are written one per line as they are made, from several threads.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "search.h"
+#include "strategies.h"
+#include "util.h"
+
+#define MIN_CLUES 17        // Fewest clues of any unique puzzle
+#define MAX_ATTEMPTS 10000  // Grids tried per puzzle before giving up
+#define MAX_THREADS 256
+
+// Difficulty, by the strategies needed to solve a puzzle without guessing
+enum difficulty {
+  ANY,
+  EASY,    // Singles only
+  MEDIUM,  // Strategies in strategies.c
+  HARD,    // Search
+};
+
+static const char *difficulty_names[] = {"any", "easy", "medium", "hard"};
+
+// Settings, fixed before threads start
+static long n_puzzles = 1;
+static int target_clues = 30;
+static enum difficulty difficulty = ANY;
+static uint64_t seed = 1;
+static unsigned singles_mask;
+
+static long next_puzzle;  // Index of next puzzle to make, taken atomically
+static int failed;        // Set if any puzzle could not be made
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// splitmix64 step
+static uint64_t rng_next(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static void shuffle(uint8_t *a, int n, uint64_t *rng) {
+  for (int k = n - 1; k > 0; k--) {
+    int r = rng_next(rng) % (k + 1);
+    uint8_t tmp = a[k];
+    a[k] = a[r];
+    a[r] = tmp;
+  }
+}
+
+// Fill cells with a random solved grid: the three diagonal blocks share no
+// house, so any digits can go in them, and the search completes the rest
+// Returns nonzero if the grid could not be completed
+static int fill_grid(uint16_t cells[HOUSE_SZ][HOUSE_SZ], uint64_t *rng) {
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++)
+      cells[i][j] = (1 << HOUSE_SZ) - 1;
+  }
+
+  for (int b = 0; b < BLK_WIDTH; b++) {
+    uint8_t digits[HOUSE_SZ] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    shuffle(digits, HOUSE_SZ, rng);
+    for (int k = 0; k < HOUSE_SZ; k++)
+      cells[b * BLK_WIDTH + k / BLK_WIDTH][b * BLK_WIDTH + k % BLK_WIDTH] = 1 << digits[k];
+  }
+
+  struct search search;
+  search_init(&search, 1);
+  return eliminate_givens(cells) || solve_mrv(cells, &search);
+}
+
+// Check puzzle has exactly one solution
+static int is_unique(uint16_t puzzle[HOUSE_SZ][HOUSE_SZ]) {
+  uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+  copy_cells(puzzle, cells);
+  if (eliminate_givens(cells))
+    return 0;
+
+  struct search search;
+  search_init(&search, 2);
+  solve_mrv(cells, &search);
+  return search.solutions == 1;
+}
+
+// Difficulty of a unique puzzle
+static enum difficulty rate(uint16_t puzzle[HOUSE_SZ][HOUSE_SZ]) {
+  struct grid grid;
+  if (grid_load(&grid, puzzle))
+    return HARD;
+  if (!grid_schedule(&grid, singles_mask, NULL))
+    return EASY;
+  return grid_solve(&grid, NULL) ? HARD : MEDIUM;
+}
+
+// Make a puzzle with target_clues clues of the requested difficulty
+// Returns nonzero if none was found in MAX_ATTEMPTS grids
+static int make_puzzle(uint16_t puzzle[HOUSE_SZ][HOUSE_SZ], uint64_t *rng) {
+  for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+    if (fill_grid(puzzle, rng))
+      continue;
+
+    uint8_t order[N_CELLS];
+    for (int n = 0; n < N_CELLS; n++)
+      order[n] = n;
+    shuffle(order, N_CELLS, rng);
+
+    // Remove clues while the solution stays unique
+    int clues = N_CELLS;
+    for (int k = 0; k < N_CELLS && clues > target_clues; k++) {
+      uint16_t *cell = &puzzle[order[k] / HOUSE_SZ][order[k] % HOUSE_SZ];
+      uint16_t clue = *cell;
+      *cell = (1 << HOUSE_SZ) - 1;
+      if (is_unique(puzzle))
+        clues--;
+      else
+        *cell = clue;
+    }
+
+    if (clues == target_clues && (difficulty == ANY || rate(puzzle) == difficulty))
+      return 0;
+  }
+  return 1;
+}
+
+static void *worker(void *arg) {
+  (void) arg;
+  long k;
+  while ((k = __atomic_fetch_add(&next_puzzle, 1, __ATOMIC_RELAXED)) < n_puzzles) {
+    // Each puzzle has its own stream, so output does not depend on threads
+    uint64_t rng = seed ^ (k * 0xd1342543de82ef95ULL);
+    uint16_t puzzle[HOUSE_SZ][HOUSE_SZ];
+    if (make_puzzle(puzzle, &rng)) {
+      __atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    char line[N_CELLS + 2];
+    cells_line_str(puzzle, line, sizeof(line));
+    pthread_mutex_lock(&out_lock);
+    fputs(line, stdout);
+    pthread_mutex_unlock(&out_lock);
+  }
+  return NULL;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-n puzzles] [-c clues] [-d difficulty] [-s seed] [-j threads]\n", name);
+  fprintf(stderr, "Writes unique-solution puzzles one per line (default 1 puzzle, 30 clues)\n");
+  fprintf(stderr, "Difficulty: any (default), easy (singles), medium (strategies), hard (search)\n");
+}
+
+int main(int argc, char **argv) {
+  int n_threads = 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:d:j:n:s:")) != -1) {
+    switch (opt) {
+      case 'c':
+        target_clues = atoi(optarg);
+        if (target_clues < MIN_CLUES || target_clues > N_CELLS) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'd':
+        difficulty = ANY;
+        while (difficulty <= HARD && strcmp(optarg, difficulty_names[difficulty]))
+          difficulty++;
+        if (difficulty > HARD) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'j':
+        n_threads = atoi(optarg);
+        if (n_threads < 1 || n_threads > MAX_THREADS) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'n':
+        n_puzzles = atol(optarg);
+        break;
+      case 's':
+        seed = strtoull(optarg, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  strat_mask_parse("singles", &singles_mask);
+
+  pthread_t threads[MAX_THREADS];
+  int started = 0;
+  for (int t = 1; t < n_threads; t++) {
+    if (pthread_create(&threads[started], NULL, worker, NULL))
+      break;
+    started++;
+  }
+  worker(NULL);
+  for (int t = 0; t < started; t++)
+    pthread_join(threads[t], NULL);
+
+  fflush(stdout);
+  if (failed)
+    fprintf(stderr, "Could not make every puzzle with %d clues\n", target_clues);
+  return failed;
+}
+
+/* vim:set ts=2 sw=2 et: */
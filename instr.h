@@ -0,0 +1,70 @@
+/**
+ * instr.h
+ * Hot-path instrumentation counters, compiled in with -DINSTRUMENT (make
+ * INSTRUMENT=1) and compiled out entirely otherwise. Counters are per
+ * thread and cover one solve: the solver calls instr_begin before it and
+ * instr_end after, which writes them to stderr as one JSON line.
+ *
+ * @author: Grace-H
+ */
+
+#ifndef INSTR_H
+#define INSTR_H
+
+#include <stdint.h>
+
+#include "util.h"
+
+#ifdef INSTRUMENT
+
+struct instr {
+  long remove_candidate;     // strategies.c remove_candidate calls
+  long propagate_calls;      // propagate & propagate_trail calls
+  long peer_eliminations;    // Peers that lost a candidate in propagation
+  long transforms_pushed;    // Choices pushed by a search engine
+  long transforms_popped;    // Choices popped on backtracking
+  int depth;                 // Choices currently pushed
+  int max_depth;             // Deepest choice stack or recursion
+  long copy_bytes;           // Bytes copied by copy_cells
+  long pq_ops;               // pq & ipq inserts, extracts & key changes
+  long strategy_calls;       // Strategies run by grid_schedule
+  long strategy_hits;        // Strategy calls that changed the grid
+  long long propagate_ns;    // Time in propagation
+  long long strategy_ns;     // Time in strategies, including their propagation
+  long long start_ns;
+  char puzzle[N_CELLS + 2];  // Puzzle as given, with newline
+};
+
+extern __thread struct instr instr;
+
+long long instr_now(void);
+void instr_begin(uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+void instr_end(const char *solver, int ret, int backtracks);
+
+#define INSTR_INC(field) (instr.field++)
+#define INSTR_ADD(field, n) (instr.field += (n))
+#define INSTR_PUSH() do {                       \
+    instr.transforms_pushed++;                  \
+    if (++instr.depth > instr.max_depth)        \
+      instr.max_depth = instr.depth;            \
+  } while (0)
+#define INSTR_POP() (instr.transforms_popped++, instr.depth--)
+#define INSTR_CLOCK(var) long long var = instr_now()
+#define INSTR_ELAPSED(field, var) (instr.field += instr_now() - (var))
+
+#else
+
+#define instr_begin(cells) ((void) 0)
+#define instr_end(solver, ret, backtracks) ((void) 0)
+#define INSTR_INC(field) ((void) 0)
+#define INSTR_ADD(field, n) ((void) 0)
+#define INSTR_PUSH() ((void) 0)
+#define INSTR_POP() ((void) 0)
+#define INSTR_CLOCK(var) ((void) 0)
+#define INSTR_ELAPSED(field, var) ((void) 0)
+
+#endif
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,190 @@
+/**
+ * pool.c
+ * Solves batches of puzzles across threads. Each thread owns a deque of
+ * puzzles, taking work from the front of its own and stealing from the back
+ * of the others once it runs dry, so a few expensive puzzles don't leave the
+ * other threads idle. Finished puzzles are handed back in input order.
+ *
+ * @author: Grace-H
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool.h"
+
+// Indices of jobs waiting to be solved
+struct deque {
+  pthread_mutex_t lock;
+  int *jobs;
+  int head;
+  int tail;
+};
+
+struct pool {
+  struct pool_job *jobs;
+  struct deque *deques;
+  int n_threads;
+  int (*solve)(struct pool_job *job);
+
+  // Reorder buffer: jobs are emitted in input order, so the main thread
+  // waits for job next to be done before emitting it
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int next;
+};
+
+struct worker {
+  struct pool *pool;
+  int id;
+};
+
+// Take job from the front of own deque
+static int deque_pop(struct deque *deque, int *job) {
+  int found = 0;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail) {
+    *job = deque->jobs[deque->head++];
+    found = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+// Take job from the back of another thread's deque
+static int deque_steal(struct deque *deque, int *job) {
+  int found = 0;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail) {
+    *job = deque->jobs[--deque->tail];
+    found = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+static void *worker_run(void *arg) {
+  struct worker *worker = arg;
+  struct pool *pool = worker->pool;
+
+  // No jobs are added once workers start, so once every deque is empty
+  // the batch is finished
+  int k;
+  for (;;) {
+    int found = deque_pop(&pool->deques[worker->id], &k);
+    for (int v = 1; !found && v < pool->n_threads; v++) {
+      found = deque_steal(&pool->deques[(worker->id + v) % pool->n_threads], &k);
+    }
+    if (!found)
+      break;
+
+    struct pool_job *job = &pool->jobs[k];
+    int ret = pool->solve(job);
+
+    pthread_mutex_lock(&pool->lock);
+    job->ret = ret;
+    job->done = 1;
+    if (k == pool->next)
+      pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  return NULL;
+}
+
+// Solve every puzzle in reader on n_threads threads, calling emit on each
+// finished job in input order from the calling thread
+// Returns nonzero if any puzzle was malformed or not solved
+int pool_solve(struct reader *reader, int n_threads,
+    int (*solve)(struct pool_job *job), void (*emit)(struct pool_job *job)) {
+  struct pool pool;
+  pool.jobs = malloc(POOL_BATCH * sizeof(struct pool_job));
+  pool.deques = malloc(n_threads * sizeof(struct deque));
+  pool.n_threads = n_threads;
+  pool.solve = solve;
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+
+  int per_deque = POOL_BATCH / n_threads + 1;
+  for (int t = 0; t < n_threads; t++) {
+    pthread_mutex_init(&pool.deques[t].lock, NULL);
+    pool.deques[t].jobs = malloc(per_deque * sizeof(int));
+  }
+
+  pthread_t *threads = malloc(n_threads * sizeof(pthread_t));
+  struct worker *workers = malloc(n_threads * sizeof(struct worker));
+
+  int failed = 0;
+  for (;;) {
+    for (int t = 0; t < n_threads; t++) {
+      pool.deques[t].head = 0;
+      pool.deques[t].tail = 0;
+    }
+
+    // Read batch, dealing puzzles round-robin so early puzzles (which are
+    // emitted first) are spread across threads
+    int n = 0;
+    int ret;
+    while (n < POOL_BATCH && (ret = reader_next(reader, pool.jobs[n].cells))) {
+      struct pool_job *job = &pool.jobs[n];
+      job->ret = ret < 0;
+      job->count = 0;
+      job->rating = 0;
+      job->done = ret < 0;
+      if (ret > 0) {
+        struct deque *deque = &pool.deques[n % n_threads];
+        deque->jobs[deque->tail++] = n;
+      }
+      n++;
+    }
+
+    if (n == 0)
+      break;
+
+    pool.next = 0;
+    int started = 0;
+    for (int t = 0; t < n_threads; t++) {
+      workers[t].pool = &pool;
+      workers[t].id = t;
+      if (pthread_create(&threads[started], NULL, worker_run, &workers[t])) {
+        perror("pthread_create");
+        break;
+      }
+      started++;
+    }
+
+    // Unstarted threads' deques get stolen, but someone has to be running
+    if (!started)
+      worker_run(&workers[0]);
+
+    for (int k = 0; k < n; k++) {
+      pthread_mutex_lock(&pool.lock);
+      pool.next = k;
+      while (!pool.jobs[k].done)
+        pthread_cond_wait(&pool.cond, &pool.lock);
+      pthread_mutex_unlock(&pool.lock);
+
+      failed |= pool.jobs[k].ret;
+      emit(&pool.jobs[k]);
+    }
+
+    for (int t = 0; t < started; t++) {
+      pthread_join(threads[t], NULL);
+    }
+  }
+
+  for (int t = 0; t < n_threads; t++) {
+    pthread_mutex_destroy(&pool.deques[t].lock);
+    free(pool.deques[t].jobs);
+  }
+  pthread_mutex_destroy(&pool.lock);
+  pthread_cond_destroy(&pool.cond);
+  free(workers);
+  free(threads);
+  free(pool.deques);
+  free(pool.jobs);
+
+  return failed;
+}
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,29 @@
+/**
+ * pool.h
+ * Multi-threaded batch solving with per-thread work-stealing deques
+ *
+ * @author: Grace-H
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "util.h"
+
+#define POOL_BATCH (1 << 14) // Puzzles read into memory & solved at a time
+
+// One puzzle in a batch
+struct pool_job {
+  uint16_t cells[HOUSE_SZ][HOUSE_SZ]; // Puzzle as read, solution when done
+  int ret;                            // Nonzero if puzzle was not solved
+  int count;                          // Solutions found, when counting
+  double rating;                      // Difficulty, when rating
+  int done;
+};
+
+int pool_solve(struct reader *reader, int n_threads,
+    int (*solve)(struct pool_job *job), void (*emit)(struct pool_job *job));
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,491 @@
+/**
+ * search.c
+ *
+ * Backtracking search engines shared by ss-opt and the tools built on it.
+ * The stack engine copies the grid at each choice; the trail engine keeps
+ * changes on an undo trail instead. The MRV engine also uses the trail,
+ * always branches on the cell with fewest candidates, and places hidden
+ * singles after every choice.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instr.h"
+#include "search.h"
+#include "strategies.h"
+#include "util.h"
+
+// Buckets of cells by candidate count for the MRV engine. Bucket c holds the
+// cells with c candidates as a 128-bit mask, and live has bit c set when
+// bucket c is non-empty, so the cell with fewest candidates is found with
+// two bit scans instead of a pass over the grid.
+struct buckets {
+  uint64_t lo[HOUSE_SZ + 1]; // Cells 0-63
+  uint64_t hi[HOUSE_SZ + 1]; // Cells 64-80
+  uint16_t live;
+  uint8_t count[N_CELLS];    // Bucket each cell is in
+};
+
+// Get block number (0->9 reading left-right top-bottom) from i,j coordinates
+// Block index is i rounded down to nearest multiple of cell size + j divided by cell size
+static inline int blk_index(int i, int j) {
+  return (i / BLK_WIDTH) * BLK_WIDTH + j / BLK_WIDTH;
+}
+
+// Determine cell number (nth cell) from i,j
+static inline int cell_index(int i, int j) {
+  return i * HOUSE_SZ + j;
+}
+
+
+// One 16-bit lane per house, in the order of the houses table
+typedef uint16_t house_lanes __attribute__((vector_size(64)));
+
+// Hidden singles strategy
+// Finds the hidden singles of all 27 houses in one pass: lane h of once &
+// twice accumulates the candidates seen at least once & twice in house h,
+// so once & ~twice holds the digits with one place left in each house.
+// Every hidden single is applied before any is propagated. If trail is
+// non-NULL, changes are recorded on it.
+// Returns the number of cells solved, or -1 on contradiction
+static int hidden_singles(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct trail *trail) {
+  uint16_t *flat = &cells[0][0];
+  house_lanes once = {0};
+  house_lanes twice = {0};
+  for (int k = 0; k < HOUSE_SZ; k++) {
+    house_lanes x = {0};
+    for (int h = 0; h < N_HOUSES; h++)
+      x[h] = flat[houses[h][k]];
+    twice |= once & x;
+    once |= x;
+  }
+  house_lanes hidden = once & ~twice;
+
+  // A digit with no place left in some house
+  for (int h = 0; h < N_HOUSES; h++) {
+    if (once[h] != (1 << HOUSE_SZ) - 1)
+      return -1;
+  }
+
+  uint8_t placed[N_CELLS];
+  int n_placed = 0;
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      int n = cell_index(i, j);
+      uint16_t c = flat[n];
+      uint16_t only = c & (hidden[i] | hidden[HOUSE_SZ + j]
+          | hidden[2 * HOUSE_SZ + blk_index(i, j)]);
+      if (!only || !(c & (c - 1)))
+        continue;
+
+      // Two digits can only go in this cell
+      if (only & (only - 1))
+        return -1;
+
+      if (trail)
+        trail_push(trail, n, c);
+      flat[n] = only;
+      placed[n_placed++] = n;
+    }
+  }
+
+  for (int p = 0; p < n_placed; p++) {
+    int i = placed[p] / HOUSE_SZ;
+    int j = placed[p] % HOUSE_SZ;
+    int ret = trail ? propagate_trail(cells, trail, i, j) : propagate(cells, NULL, i, j);
+    if (ret < 0)
+      return -1;
+  }
+  return n_placed;
+}
+
+// Apply hidden singles until there are none left
+// Returns -1 on contradiction
+static int singles_fixpoint(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct trail *trail) {
+  int ret;
+  while ((ret = hidden_singles(cells, trail)) > 0)
+    ;
+  return ret;
+}
+
+// Apply the strategies in mask to cells until they stall. If trail is
+// non-NULL, changed cells are recorded on it.
+// Returns -1 on contradiction, leaving cells unchanged
+static int hybrid_strategies(uint16_t cells[HOUSE_SZ][HOUSE_SZ], unsigned mask,
+    struct trail *trail) {
+  struct grid grid;
+  if (grid_load(&grid, cells) || grid_schedule(&grid, mask, NULL) < 0)
+    return -1;
+
+  uint16_t after[HOUSE_SZ][HOUSE_SZ];
+  grid_store(&grid, after);
+
+  uint16_t *flat = &cells[0][0];
+  for (int n = 0; n < N_CELLS; n++) {
+    if (after[n / HOUSE_SZ][n % HOUSE_SZ] != flat[n]) {
+      if (trail)
+        trail_push(trail, n, flat[n]);
+      flat[n] = after[n / HOUSE_SZ][n % HOUSE_SZ];
+    }
+  }
+  return 0;
+}
+
+// Start a search for up to limit solutions, with no strategies
+void search_init(struct search *search, int limit) {
+  search->limit = limit;
+  search->strategies = 0;
+  search->strategy_depth = -1;
+  search->solutions = 0;
+  search->backtracks = 0;
+}
+
+// Record cells as a solution if every cell is solved consistently
+// Returns nonzero once the search has found its limit of solutions
+static int search_found(struct search *search, uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  if (!is_solved(cells))
+    return 0;
+  if (!search->solutions++)
+    copy_cells(cells, search->first);
+  return search->solutions >= search->limit;
+}
+
+// Leave the first solution found in cells
+// Returns nonzero if there was none
+static int search_result(struct search *search, uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  if (!search->solutions)
+    return 1;
+  copy_cells(search->first, cells);
+  return 0;
+}
+
+// Eliminate candidates ruled out by the given digits of a freshly read puzzle
+// Returns nonzero if the givens contradict each other
+int eliminate_givens(uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      if (!(cells[i][j] & (cells[i][j] - 1)) && propagate(cells, NULL, i, j)) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+struct transform {
+  int i; // Coordinates of cell transformed
+  int j;
+  uint16_t solution;   // Current, tried solution of cell
+  uint16_t candidates; // Former candidates of cell
+  uint16_t tried;      // Candidates that have been tried as solutions
+  uint16_t (* cells)[HOUSE_SZ];    // Copy of cells before this trans applied
+};
+
+// Stack engine: solve puzzle by applying transformations to cells until search has found
+// its limit of solutions or every candidate has been tried. After each
+// solution, the search backtracks as if it had hit a contradiction.
+// Returns nonzero if the puzzle could not be solved
+int solve_stack(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search) {
+  // Construct priority queue--worklist for cells
+  // Cells with fewer candidates are higher priority
+  int priorities[N_CELLS];
+
+  struct ipq worklist;
+  ipq_init(&worklist, N_CELLS);
+  for (int n = 0; n < N_CELLS; n++) {
+    priorities[n] = 9 - bit_count(cells[n / HOUSE_SZ][n % HOUSE_SZ]);
+    ipq_insert(&worklist, n, priorities[n]);
+  }
+
+  // Initialize stack for tracking transformations
+  // At most one transformation per cell, so it never grows
+  struct astack transforms;
+  astack_init(&transforms, N_CELLS);
+
+  // Get next cell in worklist
+  int dead = 0;  // Last transformation left a cell with no candidates
+  for (;;) {
+    if (!dead && ipq_is_empty(&worklist)) {
+      if (search_found(search, cells))
+        break;
+      dead = 1;
+    }
+
+    struct transform *trans = NULL;
+
+    // Perform transformation
+    int n = dead ? -1 : ipq_extract_max(&worklist);
+
+    // If it has remaining candidates
+    if (n >= 0 && cells[n / HOUSE_SZ][n % HOUSE_SZ]) {
+      int i = n / HOUSE_SZ;
+      int j = n % HOUSE_SZ;
+
+      // Construct transformation
+      uint16_t solution = bit_lowest(cells[i][j]);
+
+      trans = malloc(sizeof(struct transform));
+      trans->i = i;
+      trans->j = j;
+      trans->solution = solution;
+      trans->candidates = cells[i][j];
+      trans->tried = solution;
+      trans->cells = malloc(HOUSE_SZ * HOUSE_SZ * sizeof(uint16_t));
+      copy_cells(cells, trans->cells);
+    } else {
+      if (n >= 0)
+        ipq_insert(&worklist, n, priorities[n]);
+
+      // Revert to first prior transformation on cell with untried candidates
+      do {
+        if (trans) {
+          int k = trans->i * HOUSE_SZ + trans->j;
+          ipq_insert(&worklist, k, priorities[k]);
+          free(trans->cells);
+          free(trans);
+        }
+
+        trans = astack_pop(&transforms);
+        search->backtracks++;
+
+        if (!trans) {
+          ipq_destroy(&worklist);
+          astack_destroy(&transforms);
+          return search_result(search, cells);
+        }
+        INSTR_POP();
+      } while ((trans->candidates & ~trans->tried) == 0);
+
+      copy_cells(trans->cells, cells);
+
+      // Construct transformation
+      uint16_t solution = bit_lowest(trans->candidates ^ trans->tried);
+
+      trans->solution = solution;
+      trans->tried |= solution;
+    }
+
+    astack_push(&transforms, trans);
+    INSTR_PUSH();
+    cells[trans->i][trans->j] = trans->solution;
+    dead = propagate(cells, NULL, trans->i, trans->j) < 0;
+  }
+
+  struct transform *trans = NULL;
+  while ((trans = astack_pop(&transforms))) {
+    free(trans->cells);
+    free(trans);
+  }
+  ipq_destroy(&worklist);
+  astack_destroy(&transforms);
+
+  return search_result(search, cells);
+}
+
+// Trail engine: same search as solve_stack, but instead of copying cells at each
+// transformation, records changed cells on an undo trail and unwinds it
+// when backtracking. Cells are visited in order of initial candidate count.
+// Returns nonzero if the puzzle could not be solved
+int solve_trail(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search) {
+  uint16_t *flat = &cells[0][0];
+
+  // Order unsolved cells, fewest candidates first
+  uint8_t order[N_CELLS];
+  int n = 0;
+  for (int count = 2; count <= HOUSE_SZ; count++) {
+    for (int c = 0; c < N_CELLS; c++) {
+      if (bit_count(flat[c]) == count)
+        order[n++] = c;
+    }
+  }
+
+  struct trail trail;
+  trail.size = 0;
+  struct choice choices[N_CELLS];
+  int depth = 0;
+
+  int k = 0;
+  int dead = 0;  // Last choice left a cell with no candidates
+  for (;;) {
+    struct choice *choice;
+    if (!dead) {
+      // Skip cells solved by propagation
+      while (k < n && !(flat[order[k]] & (flat[order[k]] - 1)))
+        k++;
+
+      if (k == n) {
+        if (search_found(search, cells))
+          break;
+        dead = 1;
+      }
+    }
+
+    if (!dead) {
+      choice = &choices[depth++];
+      INSTR_PUSH();
+      choice->cell = order[k];
+      choice->k = k;
+      choice->mark = trail.size;
+      choice->candidates = flat[order[k]];
+      choice->tried = 0;
+    } else {
+      // Revert to first prior choice on cell with untried candidates
+      for (;;) {
+        if (!depth)
+          return search_result(search, cells);
+
+        choice = &choices[depth - 1];
+        trail_undo(&trail, cells, choice->mark);
+        search->backtracks++;
+        if (choice->candidates & ~choice->tried)
+          break;
+        depth--;
+        INSTR_POP();
+      }
+      k = choice->k;
+    }
+
+    uint16_t remaining = choice->candidates & ~choice->tried;
+    uint16_t solution = bit_lowest(remaining);
+    choice->tried |= solution;
+
+    trail_push(&trail, choice->cell, flat[choice->cell]);
+    flat[choice->cell] = solution;
+    dead = propagate_trail(cells, &trail, choice->cell / HOUSE_SZ, choice->cell % HOUSE_SZ) < 0;
+  }
+
+  return search_result(search, cells);
+}
+
+// Move cell n to the bucket for its current candidate count
+static inline void buckets_set(struct buckets *b, const uint16_t *flat, int n) {
+  int from = b->count[n];
+  int to = bit_count(flat[n]);
+  if (from == to)
+    return;
+
+  uint64_t bit = 1ULL << (n & 63);
+  if (n < 64) {
+    b->lo[from] &= ~bit;
+    b->lo[to] |= bit;
+  } else {
+    b->hi[from] &= ~bit;
+    b->hi[to] |= bit;
+  }
+  if (!(b->lo[from] | b->hi[from]))
+    b->live &= ~(1 << from);
+  b->live |= 1 << to;
+  b->count[n] = to;
+}
+
+static void buckets_init(struct buckets *b, const uint16_t *flat) {
+  memset(b, 0, sizeof(*b));
+  for (int n = 0; n < N_CELLS; n++) {
+    if (n < 64)
+      b->lo[0] |= 1ULL << n;
+    else
+      b->hi[0] |= 1ULL << (n - 64);
+  }
+  b->live = 1;
+  for (int n = 0; n < N_CELLS; n++)
+    buckets_set(b, flat, n);
+}
+
+// Rebucket cells recorded on trail entries mark..top after they changed
+static void buckets_sync(struct buckets *b, const uint16_t *flat,
+    const struct trail *trail, int mark, int top) {
+  for (int e = mark; e < top; e++)
+    buckets_set(b, flat, trail->entries[e].cell);
+}
+
+// Unsolved cell with fewest candidates, or -1 if every cell is solved
+static inline int buckets_min(const struct buckets *b) {
+  uint16_t unsolved = b->live & ~3;
+  if (!unsolved)
+    return -1;
+
+  int c = bit_index(unsolved);
+  if (b->lo[c])
+    return bit_index64(b->lo[c]);
+  return 64 + bit_index64(b->hi[c]);
+}
+
+// MRV engine: trail engine that always branches on the unsolved cell with
+// the fewest candidates left after propagation, rather than following the
+// initial candidate counts. Hidden singles are placed after every choice,
+// then search->strategies down to search->strategy_depth.
+// Returns nonzero if the puzzle could not be solved
+int solve_mrv(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search) {
+  uint16_t *flat = &cells[0][0];
+
+  if (singles_fixpoint(cells, NULL) < 0)
+    return 1;
+  if (search->strategies && hybrid_strategies(cells, search->strategies, NULL) < 0)
+    return 1;
+
+  struct buckets buckets;
+  buckets_init(&buckets, flat);
+
+  struct trail trail;
+  trail.size = 0;
+  struct choice choices[N_CELLS];
+  int depth = 0;
+
+  int dead = 0;  // Last choice left a cell with no candidates
+  for (;;) {
+    struct choice *choice;
+    if (!dead) {
+      if (buckets_min(&buckets) < 0) {
+        if (search_found(search, cells))
+          break;
+        dead = 1;
+      }
+    }
+
+    if (!dead) {
+      int cell = buckets_min(&buckets);
+      choice = &choices[depth++];
+      INSTR_PUSH();
+      choice->cell = cell;
+      choice->mark = trail.size;
+      choice->candidates = flat[cell];
+      choice->tried = 0;
+    } else {
+      // Revert to first prior choice on cell with untried candidates
+      for (;;) {
+        if (!depth)
+          return search_result(search, cells);
+
+        choice = &choices[depth - 1];
+        int top = trail.size;
+        trail_undo(&trail, cells, choice->mark);
+        buckets_sync(&buckets, flat, &trail, choice->mark, top);
+        search->backtracks++;
+        if (choice->candidates & ~choice->tried)
+          break;
+        depth--;
+        INSTR_POP();
+      }
+    }
+
+    uint16_t remaining = choice->candidates & ~choice->tried;
+    uint16_t solution = bit_lowest(remaining);
+    choice->tried |= solution;
+
+    trail_push(&trail, choice->cell, flat[choice->cell]);
+    flat[choice->cell] = solution;
+    dead = propagate_trail(cells, &trail, choice->cell / HOUSE_SZ, choice->cell % HOUSE_SZ) < 0
+        || singles_fixpoint(cells, &trail) < 0
+        || (search->strategies
+            && (search->strategy_depth < 0 || depth <= search->strategy_depth)
+            && hybrid_strategies(cells, search->strategies, &trail) < 0);
+    if (!dead)
+      buckets_sync(&buckets, flat, &trail, choice->mark, trail.size);
+  }
+
+  return search_result(search, cells);
+}
+
+/* vim:set ts=2 sw=2 et: */
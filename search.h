@@ -0,0 +1,44 @@
+/**
+ * search.h
+ * Backtracking search shared by ss-opt and the tools built on it: solution
+ * limits & results, and the engines
+ *
+ * @author: Grace-H
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "util.h"
+
+// Limit, options & results of one search, shared by the engines
+struct search {
+  int limit;            // Solutions to find before stopping
+  unsigned strategies;  // Mask of strategies.c strategies the MRV engine
+                        // applies after each choice, 0 for none
+  int strategy_depth;   // Deepest choice strategies are applied after (0 for
+                        // the root only, -1 for every node)
+  int solutions;        // Solutions found, up to limit
+  int backtracks;
+  uint16_t first[HOUSE_SZ][HOUSE_SZ]; // First solution found
+};
+
+// Choice point of the trail-based engines
+struct choice {
+  int cell;            // Cell number of cell chosen
+  int k;               // Position of cell in search order
+  int mark;            // Trail size before choice applied
+  uint16_t candidates; // Former candidates of cell
+  uint16_t tried;      // Candidates that have been tried as solutions
+};
+
+void search_init(struct search *search, int limit);
+
+int eliminate_givens(uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+int solve_stack(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search);
+int solve_trail(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search);
+int solve_mrv(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
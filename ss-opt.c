@@ -3,350 +3,227 @@
  *
  * Optimized stack-based sudoku solver. Applies transformations to the sudoku grid until it
  * becomes invalid, then reverts the previous change to attempt a different solution.
+ * The search engines themselves are in search.c.
  */
 
 #include <assert.h>
+#include <getopt.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "instr.h"
+#include "pool.h"
+#include "search.h"
+#include "strategies.h"
 #include "util.h"
 
 #define N_CELLS 81
-
-struct cell {
-  int i;
-  int j;
-  int priority;  // 9 - Initial number of candidates
-};
-
-int priority(struct cell *cell) {
-  return cell->priority;
+#define IO_BUF_SZ (1 << 22) // Bytes buffered per read/write in line mode
+
+// Search engine used to solve each puzzle
+static int (*engine)(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search) = solve_stack;
+
+// Solutions to count up to with --count, or 0 to solve
+static int count_limit;
+
+// Strategies applied by the MRV engine (none unless -H), and the deepest
+// choice they are applied after (0 for the root only, -1 for every node)
+static unsigned hybrid_mask;
+static int hybrid_depth = -1;
+
+// Solve freshly read puzzle, or count its solutions up to count_limit
+// Returns nonzero if the puzzle could not be solved, or when counting, if
+// it does not have exactly one solution
+static int solve_puzzle(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search) {
+  search_init(search, count_limit ? count_limit : 1);
+  search->strategies = hybrid_mask;
+  search->strategy_depth = hybrid_depth;
+  instr_begin(cells);
+
+  int ret = eliminate_givens(cells) || engine(cells, search);
+  instr_end("ss-opt", ret, search->backtracks);
+  return count_limit ? search->solutions != 1 : ret;
 }
 
-struct transform {
-  int i; // Coordinates of cell transformed
-  int j;
-  uint16_t solution;   // Current, tried solution of cell
-  uint16_t candidates; // Former candidates of cell
-  uint16_t tried;      // Candidates that have been tried as solutions
-  uint16_t (* cells)[HOUSE_SZ];    // Copy of cells before this trans applied
-};
-
-// Get block number (0->9 reading left-right top-bottom) from i,j coordinates
-// Block index is i rounded down to nearest multiple of cell size + j divided by cell size
-static inline int blk_index(int i, int j) {
-  return (i / BLK_WIDTH) * BLK_WIDTH + j / BLK_WIDTH;
-}
+// Write solution to stdout as one line, or when counting, the number of
+// solutions found
+// A puzzle that was not solved is written as given, keeping output aligned
+// with input
+static void emit(struct pool_job *job) {
+  if (count_limit) {
+    fprintf(stdout, "%d\n", job->count);
+    return;
+  }
 
-// Get i,j coordinates of top left cell in a block from its index
-static void blk_coords(int n, int *i, int *j) {
-  *i = (n / BLK_WIDTH) * BLK_WIDTH;
-  *j = (n % BLK_WIDTH) * BLK_WIDTH;
+  char solution[N_CELLS + 2];
+  cells_line_str(job->cells, solution, sizeof(solution));
+  fputs(solution, stdout);
 }
 
-// Determine cell number (nth cell) from i,j
-static inline int cell_index(int i, int j) {
-  return i * HOUSE_SZ + j;
+// Solve job's puzzle, leaving it as given if it could not be solved
+static int solve_job(struct pool_job *job) {
+  struct search search;
+  uint16_t given[HOUSE_SZ][HOUSE_SZ];
+  memcpy(given, job->cells, sizeof(given));
+  int ret = solve_puzzle(job->cells, &search);
+  if (ret)
+    memcpy(job->cells, given, sizeof(given));
+  job->count = search.solutions;
+  return ret;
 }
 
+// Line mode: solve each puzzle in list ("-" for stdin) and write solutions
+// one per line to stdout through a large stdio buffer, so a batch makes few
+// write system calls. With n_threads > 1, puzzles are solved in parallel.
+// Returns nonzero if any puzzle could not be solved
+static int solve_list(const char *path, int n_threads) {
+  static char out_buf[IO_BUF_SZ];
 
-// Eliminate as candidate value of solved cell & propagate any other
-// solved cells process creates
-void remove_candidate(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int i, int j) {
-  uint16_t elim = ~cells[i][j];
+  struct reader reader;
+  if (reader_open(&reader, path))
+    return 1;
+  setvbuf(stdout, out_buf, _IOFBF, IO_BUF_SZ);
 
-  for (int x = 0; x < HOUSE_SZ; x++) {
-    if (j != x && cells[i][x]) {
-      uint16_t old = cells[i][x];
-      cells[i][x] &= elim;
-      if ((old & (old - 1)) && !(cells[i][x] & (cells[i][x] - 1))) {
-        remove_candidate(cells, i, x);
-      }
-    }
+  if (n_threads > 1) {
+    int failed = pool_solve(&reader, n_threads, solve_job, emit);
+    reader_close(&reader);
+    fflush(stdout);
+    return failed;
   }
 
-  for (int y = 0; y < HOUSE_SZ; y++) {
-    if (i != y && cells[y][j]) {
-      uint16_t old = cells[y][j];
-      cells[y][j] &= elim;
-      if ((old & (old - 1)) && !(cells[y][j] & (cells[y][j] - 1))) {
-        remove_candidate(cells, y, j);
-      }
-    }
+  int failed = 0;
+  int ret;
+  struct pool_job job;
+  while ((ret = reader_next(&reader, job.cells))) {
+    job.count = 0;
+    job.ret = ret < 0 ? 1 : solve_job(&job);
+    failed |= job.ret;
+    emit(&job);
   }
 
-  int z1, z2;
-  blk_coords(blk_index(i, j), &z1, &z2);
-  for (int a = z1; a < z1 + BLK_WIDTH; a++) {
-    for (int b = z2; b < z2 + BLK_WIDTH; b++) {
-      if (!(a == i && b == j) && cells[a][b]) {
-        uint16_t old = cells[a][b];
-        cells[a][b] &= elim;
-        if ((old & (old - 1)) && !(cells[a][b] & (cells[a][b] - 1))) {
-          remove_candidate(cells, a, b);
-        }
-      }
-    }
-  }
+  reader_close(&reader);
+  fflush(stdout);
+  return failed;
 }
 
-// Check if board is solved - each house has one instance of each number
-int is_solved(const uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
-	uint16_t max = 1 << HOUSE_SZ;
-	uint16_t row[HOUSE_SZ];
-	uint16_t col[HOUSE_SZ];
-	uint16_t blk[HOUSE_SZ];
-	for (int i = 0; i < HOUSE_SZ; i++) {
-		row[i] = 0;
-		col[i] = 0;
-		blk[i] = 0;
-	}
-
-	for (int i = 0; i < HOUSE_SZ; i++) {
-		for (int j = 0; j < HOUSE_SZ; j++) {
-			row[i] |= cells[i][j];
-			col[j] |= cells[i][j];
-			blk[blk_index(i, j)] |= cells[i][j];
-		}
-	}
-
-	uint16_t target = max - 1;  // 1's in bits 1-9
-	uint16_t solved = target;
-	for (int i = 0; i < HOUSE_SZ; i++) {
-		solved &= row[i];
-		solved &= col[i];
-		solved &= blk[i];
-	}
-
-	if (solved == target) {
-		return 1;
-	}
-	return 0;
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-e engine] [-H strategies [-d depth]] <puzzle file> ...\n", name);
+  fprintf(stderr, "       %s [-e engine] [-H strategies [-d depth]] [-j threads] -l <puzzle list | ->\n", name);
+  fprintf(stderr, "Engines: stack (copy grid per transformation, default), trail (undo trail),\n");
+  fprintf(stderr, "         mrv (undo trail, fewest candidates first, hidden singles)\n");
+  fprintf(stderr, "  -H  hybrid: implies -e mrv, and also applies these strategies (comma-separated,\n");
+  fprintf(stderr, "      or all):");
+  for (int s = 0; s < N_STRATEGIES; s++)
+    fprintf(stderr, " %s", strategies[s].name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -d  apply -H strategies after at most this many choices (0: root only,\n");
+  fprintf(stderr, "      -1: every node, default)\n");
+  fprintf(stderr, "  --count[=limit]  count solutions of each puzzle up to limit (default 2)\n");
+  fprintf(stderr, "                   and print the count instead; fail unless it is 1\n");
 }
 
-// Hidden singles strategy
-static void singles(uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
-  // Count options in each house
-  int row_counts[HOUSE_SZ][HOUSE_SZ];
-  int col_counts[HOUSE_SZ][HOUSE_SZ];
-  int blk_counts[HOUSE_SZ][HOUSE_SZ];
-  uint16_t row_singles[HOUSE_SZ];
-  uint16_t col_singles[HOUSE_SZ];
-  uint16_t blk_singles[HOUSE_SZ];
-  for (int i = 0; i < HOUSE_SZ; i++) {
-    for (int j = 0; j < HOUSE_SZ; j++) {
-      row_counts[i][j] = 0;
-      col_counts[i][j] = 0;
-      blk_counts[i][j] = 0;
-    }
-    row_singles[i] = 0;
-    col_singles[i] = 0;
-    blk_singles[i] = 0;
-  }
-
-  for (int i = 0; i < HOUSE_SZ; i++) {
-    for (int j = 0; j < HOUSE_SZ; j++) {
-      for (int k = 0; k < HOUSE_SZ; k++) {
-        int val = (cells[i][j] >> k) & 1;
-        row_counts[i][k] += val;
-        col_counts[j][k] += val;
-        blk_counts[blk_index(i, j)][k] += val;
-      }
-    }
-  }
-
-  for (int i = 0; i < HOUSE_SZ; i++) {
-    for (int k = 0; k < HOUSE_SZ; k++) {
-      uint16_t k_shift = 1 << k;
-      if (row_counts[i][k] == 1) {
-        row_singles[i] |= k_shift;
-      }
-      if (col_counts[i][k] == 1) {
-        col_singles[i] |= k_shift;
-      }
-      if (blk_counts[i][k] == 1) {
-        blk_singles[i] |= k_shift;
-      }
-    }
-  }
-
-  for (int i = 0; i < HOUSE_SZ; i++) {
-    for (int j = 0; j < HOUSE_SZ; j++) {
-      if (cells[i][j] & (cells[i][j] - 1)) {
-        if (cells[i][j] & row_singles[i]) {
-          cells[i][j] &= row_singles[i];
-          remove_candidate(cells, i, j);
-          break;
+int main(int argc, char **argv) {
+  const char *list = NULL;
+  int n_threads = 1;
+
+  static const struct option long_opts[] = {
+    {"count", optional_argument, NULL, 'c'},
+    {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "d:e:H:j:l:", long_opts, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        count_limit = optarg ? atoi(optarg) : 2;
+        if (count_limit < 1) {
+          usage(argv[0]);
+          return 1;
         }
-        if (cells[i][j] & col_singles[j]) {
-          cells[i][j] &= col_singles[j];
-          remove_candidate(cells, i, j);
-          break;
+        break;
+      case 'd':
+        hybrid_depth = atoi(optarg);
+        break;
+      case 'e':
+        if (!strcmp(optarg, "stack")) {
+          engine = solve_stack;
+        } else if (!strcmp(optarg, "trail")) {
+          engine = solve_trail;
+        } else if (!strcmp(optarg, "mrv")) {
+          engine = solve_mrv;
+        } else {
+          usage(argv[0]);
+          return 1;
         }
-        int blk = blk_index(i, j);
-        if (cells[i][j] & blk_singles[blk]) {
-          cells[i][j] &= blk_singles[blk];
-          remove_candidate(cells, i, j);
-          break;
+        break;
+      case 'H':
+        if (strat_mask_parse(optarg, &hybrid_mask)) {
+          usage(argv[0]);
+          return 1;
         }
-      }
+        break;
+      case 'j':
+        n_threads = atoi(optarg);
+        if (n_threads < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'l':
+        list = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
     }
   }
-}
 
+  // Hybrid strategies are only applied by the MRV engine
+  if (hybrid_mask)
+    engine = solve_mrv;
 
-int main(int argc, char **argv) {
+  if (list)
+    return solve_list(list, n_threads);
 
-  if (argc < 2) {
-    fprintf(stderr, "Usage: %s <puzzle file> ...\n", argv[0]);
+  if (optind >= argc) {
+    usage(argv[0]);
     return 1;
   }
 
-  for (int file = 1; file < argc; file++) {
-    int backtracks = 0;
-    // Initialize bitvectors of cell possibilites
-    uint16_t cells[HOUSE_SZ][HOUSE_SZ];
-    uint16_t nine = (1 << HOUSE_SZ) - 1;
-    for (int i = 0; i < HOUSE_SZ; i++) {
-      for (int j = 0; j < HOUSE_SZ; j++) {
-        cells[i][j] = nine;
-      }
-    }
-
-    // Read & parse puzzle from file
-    FILE *f = fopen(argv[file], "r");
-    if (!f) {
-      perror("open");
+  int failed = 0;
+  for (int file = optind; file < argc; file++) {
+    struct reader reader;
+    if (reader_open(&reader, argv[file]))
       return 1;
-    }
-
-    char buf[HOUSE_SZ];
-    for (int i = 0; i < HOUSE_SZ; i++) {
-      int ret = fscanf(f, "%9c\n", buf);
-      if (ret < 1) {
-        perror("fscanf");
-        fclose(f);
-        return 1;
-      }
-
-      for (int j = 0; j < HOUSE_SZ; j++) {
-        if (buf[j] != '0') {
-          char d = buf[j];
-          if (d >= '1' && d <= '9') {
-            cells[i][j] = 1 << (d - '1');
-            remove_candidate(cells, i, j);
-          } else {
-            fprintf(stderr, "Invalid digit: %d\n", d);
-            fclose(f);
-            return 1;
-          }
-        }
-      }
-    }
-
-    fclose(f);
-
-    // Construct priority queue--worklist for cells
-    // Cells with fewer candidates are higher priority
-    struct cell priorities[HOUSE_SZ][HOUSE_SZ];
 
-    struct pq worklist;
-    pq_init(&worklist, (int (*)(void *)) priority, N_CELLS);
-    for (int i = 0; i < HOUSE_SZ; i++) {
-      for (int j = 0; j < HOUSE_SZ; j++) {
-        priorities[i][j].i = i;
-        priorities[i][j].j = j;
-        priorities[i][j].priority = 9 - bit_count(cells[i][j]);
-        if (priorities[i][j].priority > 1)
-          pq_insert(&worklist, &priorities[i][j]);
+    int ret;
+    uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+    while ((ret = reader_next(&reader, cells))) {
+      struct search search = {0};
+      if (ret > 0)
+        ret = solve_puzzle(cells, &search);
+
+      if (count_limit) {
+        fprintf(stdout, "%d\n", search.solutions);
+        failed |= ret != 0;
+        continue;
       }
-    }
-
-    // Initialize stack for tracking transformations
-    struct stack transforms;
-    stack_init(&transforms);
-
-    // Get next cell in worklist
-    while (!pq_is_empty(&worklist)) {
-      struct transform *trans = NULL;
 
-      // Perform transformation
-      struct cell *cell = pq_extract_max(&worklist);
-      int i = cell->i;
-      int j = cell->j;
+      if (ret >= 0)
+        fprintf(stdout, "%d", search.backtracks);
 
-      // If it has remaining candidates
-      if (cells[i][j]) {
-
-        // Construct transformation
-        uint16_t solution = 1;
-        while (!(cells[i][j] & solution)) {
-          solution <<= 1;
-        }
-
-        trans = malloc(sizeof(struct transform));
-        trans->i = i;
-        trans->j = j;
-        trans->solution = solution;
-        trans->candidates = cells[i][j];
-        trans->tried = solution;
-        trans->cells = malloc(HOUSE_SZ * HOUSE_SZ * sizeof(uint16_t));
-        copy_cells(cells, trans->cells);
-      } else {
-        pq_insert(&worklist, &priorities[i][j]);
-
-        // Revert to first prior transformation on cell with untried candidates
-        do {
-          if (trans) {
-            pq_insert(&worklist, &priorities[trans->i][trans->j]);
-            free(trans->cells);
-            free(trans);
-          }
-
-          trans = stack_pop(&transforms);
-          backtracks++;
-
-          if (!trans) {
-            return 1;
-          }
-        } while ((trans->candidates & ~trans->tried) == 0);
-
-        //assert(((struct cell *) pq_extract_max(&worklist))->i == trans->i);
-        // n = trans->i * HOUSE_SZ + trans->j;
-
-        copy_cells(trans->cells, cells);
-
-        // Construct transformation
-        uint16_t solution = 1;
-        uint16_t remaining = trans->candidates ^ trans->tried;
-        while (!(remaining & solution)) {
-          solution <<= 1;
-        }
-
-        trans->solution = solution;
-        trans->tried |= solution;
+      // Terminate early on failure
+      if (ret) {
+        reader_close(&reader);
+        return 1;
       }
-
-      stack_push(&transforms, trans);
-      cells[trans->i][trans->j] = trans->solution;
-      remove_candidate(cells, trans->i, trans->j);
     }
-
-    fprintf(stdout, "%d", backtracks);
-
-    struct transform *trans = NULL;
-    while ((trans = stack_pop(&transforms))) {
-      free(trans->cells);
-      free(trans);
-    }
-
-    // Terminate early on failure
-    if (!is_solved(cells))
-      return 1;
+    reader_close(&reader);
   }
-  return 0;
+  return failed;
 }
 
 /* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,56 @@
+/**
+ * strategies.h
+ * Traditional (human) sudoku strategies, as applied by ts.c. All state is in
+ * an explicit grid, so any number of grids can be worked on at once.
+ *
+ * @author: Grace-H
+ */
+
+#ifndef STRATEGIES_H
+#define STRATEGIES_H
+
+#include <stdio.h>
+
+#include "util.h"
+
+#define N_STRATEGIES 9
+#define STRAT_ALL ((1u << N_STRATEGIES) - 1) // Mask of every strategy
+#define RATING_GIVENS 1.0  // Rating of a puzzle solved by placing the givens
+
+// Puzzle being solved. When a cell is solved its value moves from cells to
+// solved, leaving no candidates in cells.
+struct grid {
+  uint16_t cells[HOUSE_SZ][HOUSE_SZ];  // Candidates
+  uint16_t solved[HOUSE_SZ][HOUSE_SZ]; // Solutions
+};
+
+// Strategy as run by the scheduler, cheapest first in strategies[]
+struct strategy {
+  const char *name;
+  void (*apply)(struct grid *g);
+  double weight; // Rating of a puzzle that needs it, and nothing harder
+};
+
+extern const struct strategy strategies[N_STRATEGIES];
+
+// What the scheduler did, per strategy in strategies[]
+struct strat_stats {
+  long calls[N_STRATEGIES];
+  long hits[N_STRATEGIES];     // Calls that changed the grid
+  long long ns[N_STRATEGIES];  // Time spent in calls
+};
+
+int grid_load(struct grid *g, uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+void grid_store(const struct grid *g, uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+int grid_unsolved(const struct grid *g);
+int grid_schedule(struct grid *g, unsigned mask, struct strat_stats *stats);
+int grid_solve(struct grid *g, struct strat_stats *stats);
+int strat_mask_parse(const char *names, unsigned *mask);
+double strat_rating(const struct strat_stats *trace, int result);
+
+void strat_stats_merge(struct strat_stats *dst, const struct strat_stats *src);
+void strat_stats_print(const struct strat_stats *stats, FILE *f);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
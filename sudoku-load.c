@@ -0,0 +1,283 @@
+/**
+ * sudoku-load.c
+ *
+ * Load generator for sudokud. Sends the puzzles of a list over several
+ * connections at once, each keeping up to a window of puzzles in flight,
+ * and reports throughput and the latency of each puzzle from when it was
+ * sent to when its reply came back.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CONNS 1024
+#define MAX_WINDOW 4096  // sudokud's own window; more could deadlock
+#define BUF_SZ (1 << 16)
+
+// Settings & puzzles, fixed before threads start
+static const char *path;
+static char **lines;
+static long n_lines;
+static size_t max_len;  // Longest line, without its newline
+static long n_puzzles;
+static int n_conns = 1;
+static int window = 64;
+static int print_replies;
+
+// Results, each written by the one connection that sends the puzzle
+static long long *latency_ns;
+static char **replies;
+
+static const char *result_names[] = {"solved", "unsolved", "multiple", "invalid"};
+#define N_RESULTS 4
+static long results[N_RESULTS + 1];  // Last counts replies that are none of the above
+static pthread_mutex_t results_lock = PTHREAD_MUTEX_INITIALIZER;
+static int failed;
+
+static long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int connect_to(const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+    perror(path);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+  while (len) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0)
+      return -1;
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// Send puzzles conn, conn + n_conns, ... and read their replies
+static void *run_conn(void *arg) {
+  long conn = (long) arg;
+  long mine = (n_puzzles - conn + n_conns - 1) / n_conns;
+  long counts[N_RESULTS + 1] = {0};
+  int fd = connect_to(path);
+  if (fd < 0) {
+    __atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+
+  char *out = malloc(window * (max_len + 1));
+  char *in = malloc(BUF_SZ);
+  size_t in_len = 0;
+  long sent = 0;
+  long received = 0;
+  while (received < mine) {
+    // Top up the window in one write
+    size_t out_len = 0;
+    long first = sent;
+    while (sent < mine && sent - received < window) {
+      const char *line = lines[(conn + sent * n_conns) % n_lines];
+      size_t len = strlen(line);
+      memcpy(out + out_len, line, len);
+      out[out_len + len] = '\n';
+      out_len += len + 1;
+      sent++;
+    }
+    if (out_len) {
+      long long now = now_ns();
+      for (long k = first; k < sent; k++)
+        latency_ns[conn + k * n_conns] = now;
+      if (write_all(fd, out, out_len)) {
+        perror("write");
+        break;
+      }
+    }
+
+    ssize_t n = read(fd, in + in_len, BUF_SZ - in_len);
+    if (n <= 0) {
+      fprintf(stderr, "Connection closed after %ld of %ld replies\n", received, mine);
+      break;
+    }
+    in_len += n;
+
+    long long now = now_ns();
+    char *start = in;
+    char *nl;
+    while ((nl = memchr(start, '\n', in + in_len - start))) {
+      long k = conn + received * n_conns;
+      latency_ns[k] = now - latency_ns[k];
+
+      char *result = memchr(start, ' ', nl - start);
+      int r = 0;
+      while (result && r < N_RESULTS && strncmp(result + 1, result_names[r], strlen(result_names[r])))
+        r++;
+      counts[result ? r : N_RESULTS]++;
+      if (print_replies)
+        replies[k] = strndup(start, nl + 1 - start);
+
+      received++;
+      start = nl + 1;
+    }
+    in_len = in + in_len - start;
+    memmove(in, start, in_len);
+  }
+
+  close(fd);
+  free(in);
+  free(out);
+
+  pthread_mutex_lock(&results_lock);
+  for (int r = 0; r <= N_RESULTS; r++)
+    results[r] += counts[r];
+  if (received < mine)
+    failed = 1;
+  pthread_mutex_unlock(&results_lock);
+  return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+  long long x = *(const long long *) a;
+  long long y = *(const long long *) b;
+  return (x > y) - (x < y);
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-c connections] [-w window] [-n puzzles] [-o] socket <list|->\n", name);
+  fprintf(stderr, "Sends each puzzle of list to sudokud, cycling through it for -n puzzles\n");
+  fprintf(stderr, "-o writes the replies to stdout in list order, and the report to stderr\n");
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "c:n:ow:")) != -1) {
+    switch (opt) {
+      case 'c':
+        n_conns = atoi(optarg);
+        if (n_conns < 1 || n_conns > MAX_CONNS) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'n':
+        n_puzzles = atol(optarg);
+        break;
+      case 'o':
+        print_replies = 1;
+        break;
+      case 'w':
+        window = atoi(optarg);
+        if (window < 1 || window > MAX_WINDOW) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind != argc - 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  path = argv[optind];
+
+  FILE *file = strcmp(argv[optind + 1], "-") ? fopen(argv[optind + 1], "r") : stdin;
+  if (!file) {
+    perror(argv[optind + 1]);
+    return 1;
+  }
+  long cap = 1024;
+  lines = malloc(cap * sizeof(char *));
+  char *line = NULL;
+  size_t line_cap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &line_cap, file)) > 0) {
+    while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+      line[--len] = '\0';
+    if (!len)
+      continue;
+    if (n_lines == cap) {
+      cap *= 2;
+      lines = realloc(lines, cap * sizeof(char *));
+    }
+    lines[n_lines++] = strdup(line);
+    if ((size_t) len > max_len)
+      max_len = len;
+  }
+  free(line);
+  if (file != stdin)
+    fclose(file);
+
+  if (!n_lines) {
+    fprintf(stderr, "No puzzles in %s\n", argv[optind + 1]);
+    return 1;
+  }
+  if (n_puzzles <= 0)
+    n_puzzles = n_lines;
+  if (n_conns > n_puzzles)
+    n_conns = n_puzzles;
+
+  latency_ns = malloc(n_puzzles * sizeof(long long));
+  if (print_replies)
+    replies = calloc(n_puzzles, sizeof(char *));
+
+  long long start = now_ns();
+  pthread_t threads[MAX_CONNS];
+  int started = 0;
+  for (long c = 0; c < n_conns; c++) {
+    if (pthread_create(&threads[started], NULL, run_conn, (void *) c)) {
+      perror("pthread_create");
+      failed = 1;
+      break;
+    }
+    started++;
+  }
+  for (int t = 0; t < started; t++)
+    pthread_join(threads[t], NULL);
+  double seconds = (now_ns() - start) / 1e9;
+
+  if (failed) {
+    fprintf(stderr, "Not every puzzle was answered\n");
+    return 1;
+  }
+
+  FILE *report = stdout;
+  if (print_replies) {
+    for (long k = 0; k < n_puzzles; k++)
+      fputs(replies[k], stdout);
+    fflush(stdout);
+    report = stderr;
+  }
+
+  qsort(latency_ns, n_puzzles, sizeof(long long), cmp_ll);
+  fprintf(report, "puzzles %ld connections %d window %d seconds %.3f puzzles_per_sec %.0f\n",
+      n_puzzles, n_conns, window, seconds, n_puzzles / seconds);
+  fprintf(report, "latency_us min %.1f median %.1f p99 %.1f max %.1f\n",
+      latency_ns[0] / 1e3, latency_ns[n_puzzles / 2] / 1e3,
+      latency_ns[(n_puzzles - 1) * 99 / 100] / 1e3, latency_ns[n_puzzles - 1] / 1e3);
+  for (int r = 0; r < N_RESULTS; r++)
+    fprintf(report, "%s%s %ld", r ? " " : "", result_names[r], results[r]);
+  if (results[N_RESULTS])
+    fprintf(report, " malformed %ld", results[N_RESULTS]);
+  fprintf(report, "\n");
+  return 0;
+}
+
+/* vim:set ts=2 sw=2 et: */
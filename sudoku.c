@@ -0,0 +1,225 @@
+/**
+ * sudoku.c
+ *
+ * libsudoku: one entry point over the engines of ss-opt, bt-opt, ts, bb &
+ * dlx. Puzzles go in and out as 81-character strings; all state of a solve
+ * is on the caller's stack.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backtrack.h"
+#include "bitboard.h"
+#include "cache.h"
+#include "canon.h"
+#include "exact_cover.h"
+#include "search.h"
+#include "strategies.h"
+#include "sudoku.h"
+#include "util.h"
+
+// The library is built with hidden visibility; only the API is exported
+#define SUDOKU_EXPORT __attribute__((visibility("default")))
+
+// Fewest clues of a puzzle looked up in a cache. Sparser grids never have
+// one solution, and tie on so many arrangements that canonicalizing them
+// costs more than solving them.
+#define CACHE_MIN_CLUES 17
+
+struct sudoku_cache {
+  struct cache cache;
+};
+
+// Build the engines' tables once, when the library is loaded
+__attribute__((constructor))
+static void sudoku_init(void) {
+  bitboard_init();
+  dlx_init();
+}
+
+// Solve cells with the engine in options, filling in stats
+// Returns nonzero if no solution was found
+static int solve_cells(uint16_t cells[HOUSE_SZ][HOUSE_SZ],
+    const struct sudoku_options *options, struct sudoku_stats *stats) {
+  int limit = options->limit > 1 ? options->limit : 1;
+
+  switch (options->engine) {
+    case SUDOKU_MRV:
+    case SUDOKU_TRAIL: {
+      struct search search;
+      search_init(&search, limit);
+      search.strategies = options->strategies & STRAT_ALL;
+      search.strategy_depth = options->strategy_depth;
+      int ret = eliminate_givens(cells)
+          || (options->engine == SUDOKU_MRV ? solve_mrv : solve_trail)(cells, &search);
+      stats->solutions = search.solutions;
+      stats->backtracks = search.backtracks;
+      return ret;
+    }
+
+    case SUDOKU_BACKTRACK: {
+      backtrack_load(cells);
+      int ret = backtrack_solve(cells, &stats->backtracks);
+      backtrack_store(cells);
+      stats->solutions = !ret;
+      return ret;
+    }
+
+    case SUDOKU_STRATEGIES: {
+      struct grid grid;
+      if (grid_load(&grid, cells))
+        return 1;
+      struct strat_stats trace = {{0}};
+      int ret = grid_solve(&grid, &trace);
+      grid_store(&grid, cells);
+      stats->rating = strat_rating(&trace, ret);
+      stats->solutions = !ret;
+      return ret != 0;
+    }
+
+    case SUDOKU_BITBOARD: {
+      int ret = bitboard_solve(cells, &stats->backtracks);
+      stats->solutions = !ret;
+      return ret;
+    }
+
+    case SUDOKU_DLX: {
+      int found = dlx_count(cells, limit, &stats->backtracks);
+      stats->solutions = found > 0 ? found : 0;
+      return found < 1 || !is_solved(cells);
+    }
+  }
+  return 1;
+}
+
+// Write grid, 0 for empty, to out81 as 81 digits and a NUL
+static void grid_str(const uint8_t grid[N_CELLS], char *out81) {
+  for (int n = 0; n < N_CELLS; n++)
+    out81[n] = '0' + grid[n];
+  out81[N_CELLS] = '\0';
+}
+
+SUDOKU_EXPORT
+int sudoku_solve(const char *in81, char *out81, const struct sudoku_options *options,
+    struct sudoku_stats *stats) {
+  static const struct sudoku_options defaults = {SUDOKU_MRV, 1, 0, -1, NULL};
+  struct sudoku_stats ignored;
+  if (!options)
+    options = &defaults;
+  if (!stats)
+    stats = &ignored;
+  memset(stats, 0, sizeof(*stats));
+
+  if (options->engine < SUDOKU_MRV || options->engine > SUDOKU_DLX)
+    return SUDOKU_INVALID;
+
+  char digits[N_CELLS];
+  for (int n = 0; n < N_CELLS; n++) {
+    if (!in81[n])
+      return SUDOKU_INVALID;
+    digits[n] = in81[n] == '.' ? '0' : in81[n];
+  }
+
+  uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+  if (parse_cells(digits, N_CELLS, &cells[0][0]) >= 0)
+    return SUDOKU_INVALID;
+
+  // Look the puzzle up by canonical form, unless it is too sparse or too
+  // symmetric to be worth it. The strategies' partial results and ratings
+  // are not cached.
+  struct cache *cache = NULL;
+  int limit = options->limit > 1 ? options->limit : 1;
+  uint8_t grid[N_CELLS];
+  uint8_t canon[N_CELLS];
+  struct canon_transform transform;
+  struct cache_value value;
+  if (options->cache && options->engine != SUDOKU_STRATEGIES) {
+    cache = &options->cache->cache;
+    int clues = 0;
+    for (int n = 0; n < N_CELLS; n++) {
+      grid[n] = digits[n] - '0';
+      clues += grid[n] != 0;
+    }
+    if (clues < CACHE_MIN_CLUES || canon_form(grid, canon, &transform)) {
+      cache_skip(cache);
+      cache = NULL;
+    } else if (!cache_get(cache, canon, limit, &value)) {
+      stats->solutions = value.solutions;
+      stats->cached = 1;
+      if (out81 && value.ret == SUDOKU_UNSOLVED) {
+        memcpy(out81, digits, N_CELLS);
+        out81[N_CELLS] = '\0';
+      } else if (out81) {
+        canon_invert(&transform, value.solution, grid);
+        grid_str(grid, out81);
+      }
+      return value.ret;
+    }
+  }
+
+  int ret = solve_cells(cells, options, stats);
+  char line[N_CELLS + 2];
+  cells_line_str(cells, line, sizeof(line));
+
+  // Leave the puzzle as given if it was not solved, except for the cells the
+  // strategies did solve
+  if (out81) {
+    memcpy(out81, ret && options->engine != SUDOKU_STRATEGIES ? digits : line, N_CELLS);
+    out81[N_CELLS] = '\0';
+  }
+
+  ret = ret ? SUDOKU_UNSOLVED : stats->solutions > 1 ? SUDOKU_MULTIPLE : SUDOKU_SOLVED;
+  if (cache) {
+    value.ret = ret;
+    value.solutions = stats->solutions;
+    memset(value.solution, 0, N_CELLS);
+    if (ret != SUDOKU_UNSOLVED) {
+      for (int n = 0; n < N_CELLS; n++)
+        grid[n] = line[n] - '0';
+      canon_apply(&transform, grid, value.solution);
+    }
+    cache_put(cache, canon, limit, &value);
+  }
+  return ret;
+}
+
+SUDOKU_EXPORT
+struct sudoku_cache *sudoku_cache_create(long capacity) {
+  struct sudoku_cache *cache = malloc(sizeof(struct sudoku_cache));
+  if (!cache)
+    return NULL;
+  if (cache_init(&cache->cache, capacity > CACHE_MAX ? CACHE_MAX : capacity)) {
+    free(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+SUDOKU_EXPORT
+void sudoku_cache_destroy(struct sudoku_cache *cache) {
+  if (!cache)
+    return;
+  cache_destroy(&cache->cache);
+  free(cache);
+}
+
+SUDOKU_EXPORT
+void sudoku_cache_stats(struct sudoku_cache *cache, struct sudoku_cache_stats *stats) {
+  pthread_mutex_lock(&cache->cache.lock);
+  stats->hits = cache->cache.hits;
+  stats->misses = cache->cache.misses;
+  stats->skipped = cache->cache.skipped;
+  stats->evictions = cache->cache.evictions;
+  stats->entries = cache->cache.n_entries;
+  stats->capacity = cache->cache.capacity;
+  pthread_mutex_unlock(&cache->cache.lock);
+}
+
+SUDOKU_EXPORT
+int sudoku_strategy_mask(const char *names, unsigned *mask) {
+  return strat_mask_parse(names, mask);
+}
+
+/* vim:set ts=2 sw=2 et: */
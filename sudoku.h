@@ -0,0 +1,93 @@
+/**
+ * sudoku.h
+ * Public API of libsudoku: the solver engines as a library. sudoku_solve
+ * does no I/O and allocates nothing, and any number of threads may call it
+ * at once.
+ *
+ * @author: Grace-H
+ */
+
+#ifndef SUDOKU_H
+#define SUDOKU_H
+
+#define SUDOKU_API_VERSION 2
+
+#define SUDOKU_STRATEGIES_ALL (~0u) // Every ts strategy, for options.strategies
+
+// Return values of sudoku_solve
+#define SUDOKU_SOLVED 0     // Solved; when counting, exactly one solution
+#define SUDOKU_UNSOLVED 1   // No solution, or the strategies stalled
+#define SUDOKU_MULTIPLE 2   // When counting, more than one solution
+#define SUDOKU_INVALID -1   // in81 is not a puzzle
+
+enum sudoku_engine {
+  SUDOKU_MRV,         // ss-opt -e mrv: undo trail, fewest candidates first (default)
+  SUDOKU_TRAIL,       // ss-opt -e trail: undo trail, fixed cell order
+  SUDOKU_BACKTRACK,   // bt-opt: one solution per cell, most constrained first
+  SUDOKU_STRATEGIES,  // ts: strategies only, no guessing; may leave cells unsolved
+  SUDOKU_BITBOARD,    // bb: one candidate board per digit
+  SUDOKU_DLX,         // dlx: exact cover with dancing links
+};
+
+// Options of a solve. A NULL options pointer solves with SUDOKU_MRV.
+struct sudoku_options {
+  enum sudoku_engine engine;
+  int limit;              // Solutions to count before stopping, 0 or 1 to just
+                          // solve, 2 to check uniqueness (MRV, TRAIL & DLX)
+  unsigned strategies;    // MRV: ts strategies to apply after each choice, as
+                          // a mask from sudoku_strategy_mask or
+                          // SUDOKU_STRATEGIES_ALL; 0 for none
+  int strategy_depth;     // MRV: deepest choice strategies are applied after
+                          // (0 for the root only, -1 for every node)
+  struct sudoku_cache *cache;  // Results to reuse and add to, or NULL; not
+                               // used by STRATEGIES
+};
+
+// What a solve did
+struct sudoku_stats {
+  int solutions;    // Solutions found, up to limit
+  int backtracks;   // Guesses that led to no solution
+  double rating;    // STRATEGIES: difficulty, as ts -r prints it; if
+                    // UNSOLVED, only of the steps the strategies took
+  int cached;       // Nonzero if the result came from options.cache
+};
+
+// Solution cache, shared by any number of threads. Puzzles are looked up
+// by canonical form, so a puzzle hits on the result of any puzzle it is
+// equivalent to by transposition, band, stack, row & column swaps and
+// relabeling digits. The solution given on a hit is a solution, but for a
+// puzzle with several it need not be the one the engine would have found.
+struct sudoku_cache;
+
+struct sudoku_cache_stats {
+  long hits;
+  long misses;
+  long skipped;     // Puzzles under 17 clues or too symmetric to
+                    // canonicalize quickly, solved without the cache
+  long evictions;   // Results dropped, least recently used first
+  long entries;
+  long capacity;
+};
+
+// Solve in81, 81 characters of digits 1-9 with 0 or '.' for an empty cell.
+// If out81 is non-NULL, the first solution is written to it as 81 digits
+// and a NUL, with 0 in any cell left unsolved. If stats is non-NULL, it is
+// filled in.
+// Returns SUDOKU_SOLVED, SUDOKU_UNSOLVED, SUDOKU_MULTIPLE or SUDOKU_INVALID
+int sudoku_solve(const char *in81, char *out81, const struct sudoku_options *options,
+    struct sudoku_stats *stats);
+
+// Make a cache of up to capacity results, at most 2^30
+// Returns NULL if it could not be allocated
+struct sudoku_cache *sudoku_cache_create(long capacity);
+void sudoku_cache_destroy(struct sudoku_cache *cache);
+void sudoku_cache_stats(struct sudoku_cache *cache, struct sudoku_cache_stats *stats);
+
+// Parse comma-separated ts strategy names, or "all", into a mask for
+// options.strategies
+// Returns nonzero if a name is not a strategy
+int sudoku_strategy_mask(const char *names, unsigned *mask);
+
+#endif
+
+/* vim:set ts=2 sw=2 et: */
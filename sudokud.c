@@ -0,0 +1,591 @@
+/**
+ * sudokud.c
+ *
+ * Solver daemon. Listens on a Unix socket and solves puzzles with libsudoku
+ * for as long as it runs, so callers pay process startup once rather than
+ * per puzzle. Each line a client sends is a puzzle, 81 characters of digits
+ * with 0 or '.' for an empty cell, and each gets one line back:
+ *
+ *   <solution> <result> <solutions> <backtracks> <microseconds>
+ *
+ * where result is solved, unsolved, multiple or invalid (with solution "-").
+ * Clients may pipeline any number of puzzles; replies come back in the
+ * order the puzzles were sent. One thread runs an epoll loop over the
+ * socket and the connections, handing puzzles to a pool of solver threads,
+ * which hand replies back through an eventfd.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sudoku.h"
+#include "util.h"
+
+#define MAX_THREADS 256
+#define MAX_EVENTS 64
+#define IN_BUF_SZ (1 << 16)  // Longest line a client may send, and then some
+#define WINDOW (1 << 12)     // Puzzles in flight per connection; a power of 2
+#define REPLY_SZ 128
+#define OUT_MAX (WINDOW * REPLY_SZ)  // Unwritten reply bytes before reading stops
+
+static const char *engine_names[] = {"mrv", "trail", "backtrack", "strategies", "bitboard", "dlx"};
+static const char *result_names[] = {"solved", "unsolved", "multiple"};
+
+struct conn;
+
+// A puzzle from a connection, and later its reply
+struct job {
+  struct conn *conn;
+  struct job *next;             // In the work or done queue, or the free list
+  char puzzle[N_CELLS + 1];
+  char reply[REPLY_SZ];
+  int reply_len;
+  int done;                     // Reply is ready; only read by the loop
+};
+
+struct conn {
+  int fd;
+  char in[IN_BUF_SZ];
+  size_t in_len;
+  char *out;                    // Replies not yet written
+  size_t out_len;
+  size_t out_pos;
+  size_t out_cap;
+  struct job *window[WINDOW];   // Puzzles in flight, by sequence number
+  unsigned next_seq;            // Sequence number of the next puzzle read
+  unsigned emit_seq;            // Sequence number of the next reply written
+  uint32_t events;              // Events the epoll set has for fd
+  int eof;                      // Client is done sending
+  int dead;                     // fd is closed; free once jobs come back
+  struct conn *next_dead;
+};
+
+// Jobs passed between the loop and the solvers
+struct jobs {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct job *head;
+  struct job *tail;
+  int closed;
+};
+
+// Settings, fixed before threads start
+static struct sudoku_options options = {SUDOKU_MRV, 1, 0, -1, NULL};
+
+static struct jobs work = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+static struct jobs done = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+static int wake_fd;         // eventfd the solvers signal finished jobs on
+static int epoll_fd;
+static struct job *free_jobs;  // Only touched by the loop
+static struct conn *dead_conns;  // Closed, but maybe still named by events or jobs
+static long served;
+
+// Tags for the epoll data of the fds that are not connections
+static char listen_tag, wake_tag, signal_tag;
+
+static void jobs_put(struct jobs *queue, struct job *job) {
+  job->next = NULL;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->tail)
+    queue->tail->next = job;
+  else
+    queue->head = job;
+  queue->tail = job;
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+// Take one job, waiting for one if wait is set
+// Returns NULL if there is none, or the queue is closed
+static struct job *jobs_take(struct jobs *queue, int wait) {
+  pthread_mutex_lock(&queue->lock);
+  while (wait && !queue->head && !queue->closed)
+    pthread_cond_wait(&queue->cond, &queue->lock);
+  struct job *job = queue->closed ? NULL : queue->head;
+  if (job) {
+    queue->head = job->next;
+    if (!queue->head)
+      queue->tail = NULL;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return job;
+}
+
+static void jobs_close(struct jobs *queue) {
+  pthread_mutex_lock(&queue->lock);
+  queue->closed = 1;
+  pthread_cond_broadcast(&queue->cond);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+static long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void solve_job(struct job *job) {
+  char out[N_CELLS + 1];
+  struct sudoku_stats stats;
+  long long start = now_ns();
+  int ret = sudoku_solve(job->puzzle, out, &options, &stats);
+  long us = (now_ns() - start) / 1000;
+
+  if (ret == SUDOKU_INVALID)
+    job->reply_len = snprintf(job->reply, REPLY_SZ, "- invalid 0 0 %ld\n", us);
+  else
+    job->reply_len = snprintf(job->reply, REPLY_SZ, "%s %s %d %d %ld\n",
+        out, result_names[ret], stats.solutions, stats.backtracks, us);
+}
+
+static void *worker(void *arg) {
+  (void) arg;
+  struct job *job;
+  const uint64_t one = 1;
+  while ((job = jobs_take(&work, 1))) {
+    solve_job(job);
+    jobs_put(&done, job);
+    if (write(wake_fd, &one, sizeof(one)) < 0)
+      perror("write");
+  }
+  return NULL;
+}
+
+static struct job *job_alloc(void) {
+  struct job *job = free_jobs;
+  if (job)
+    free_jobs = job->next;
+  else
+    job = malloc(sizeof(struct job));
+  return job;
+}
+
+static void job_free(struct job *job) {
+  job->next = free_jobs;
+  free_jobs = job;
+}
+
+// Whether conn must stop taking puzzles until replies go out
+static int conn_full(struct conn *conn) {
+  return conn->next_seq - conn->emit_seq >= WINDOW || conn->out_len - conn->out_pos >= OUT_MAX;
+}
+
+// Set the epoll events of conn to what it can do now
+static void conn_update(struct conn *conn) {
+  uint32_t events = 0;
+  if (!conn->eof && !conn_full(conn) && conn->in_len < IN_BUF_SZ)
+    events |= EPOLLIN;
+  if (conn->out_pos < conn->out_len)
+    events |= EPOLLOUT;
+  if (events != conn->events) {
+    struct epoll_event ev = {.events = events, .data.ptr = conn};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->events = events;
+  }
+}
+
+// Close conn's fd. conn itself is freed by reap_conns once no job or
+// pending event refers to it.
+static void conn_kill(struct conn *conn) {
+  if (conn->dead)
+    return;
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+  close(conn->fd);
+  conn->dead = 1;
+  conn->next_dead = dead_conns;
+  dead_conns = conn;
+}
+
+// Free closed connections with no jobs in flight, between epoll_waits
+static void reap_conns(void) {
+  struct conn **link = &dead_conns;
+  while (*link) {
+    struct conn *conn = *link;
+    if (conn->next_seq == conn->emit_seq) {
+      *link = conn->next_dead;
+      free(conn->out);
+      free(conn);
+    } else {
+      link = &conn->next_dead;
+    }
+  }
+}
+
+// Queue a job for each whole line read, while the window has room
+// Returns nonzero if a line is too long to ever fit, or out of memory
+static int conn_parse(struct conn *conn) {
+  size_t pos = 0;
+  int failed = 0;
+  while (!conn_full(conn)) {
+    char *nl = memchr(conn->in + pos, '\n', conn->in_len - pos);
+    if (!nl)
+      break;
+
+    size_t len = nl - (conn->in + pos);
+    if (len && conn->in[pos + len - 1] == '\r')
+      len--;
+    if (len) {
+      // Anything but exactly 81 characters fails sudoku_solve
+      struct job *job = job_alloc();
+      if (!job) {
+        failed = 1;
+        break;
+      }
+      if (len == N_CELLS)
+        memcpy(job->puzzle, conn->in + pos, N_CELLS);
+      job->puzzle[len == N_CELLS ? N_CELLS : 0] = '\0';
+      job->conn = conn;
+      job->done = 0;
+      conn->window[conn->next_seq++ % WINDOW] = job;
+      jobs_put(&work, job);
+    }
+    pos = nl + 1 - conn->in;
+  }
+
+  memmove(conn->in, conn->in + pos, conn->in_len - pos);
+  conn->in_len -= pos;
+  return failed || conn->in_len == IN_BUF_SZ;
+}
+
+// Write as much of conn's replies as the socket takes
+// Returns nonzero if the connection failed
+static int conn_write(struct conn *conn) {
+  while (conn->out_pos < conn->out_len) {
+    ssize_t n = send(conn->fd, conn->out + conn->out_pos, conn->out_len - conn->out_pos,
+        MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno != EAGAIN && errno != EWOULDBLOCK;
+    }
+    conn->out_pos += n;
+  }
+  conn->out_pos = 0;
+  conn->out_len = 0;
+  return 0;
+}
+
+// Move finished replies at the front of the window to conn's output, then
+// close conn if it is done
+static void conn_flush(struct conn *conn) {
+  while (conn->emit_seq != conn->next_seq) {
+    struct job *job = conn->window[conn->emit_seq % WINDOW];
+    if (!job->done)
+      break;
+    if (!conn->dead && conn->out_len + job->reply_len > conn->out_cap) {
+      size_t cap = 2 * (conn->out_len + job->reply_len);
+      char *out = realloc(conn->out, cap);
+      if (out) {
+        conn->out = out;
+        conn->out_cap = cap;
+      } else {
+        conn_kill(conn);
+      }
+    }
+    if (!conn->dead) {
+      memcpy(conn->out + conn->out_len, job->reply, job->reply_len);
+      conn->out_len += job->reply_len;
+    }
+    job_free(job);
+    conn->emit_seq++;
+    served++;
+  }
+
+  if (conn->dead)
+    return;
+
+  // Then lines left over from when conn was full
+  if (conn_write(conn) || conn_parse(conn)) {
+    conn_kill(conn);
+    return;
+  }
+  if (conn->eof && conn->next_seq == conn->emit_seq && !conn->out_len) {
+    conn_kill(conn);
+    return;
+  }
+  conn_update(conn);
+}
+
+static void conn_read(struct conn *conn) {
+  while (conn->in_len < IN_BUF_SZ) {
+    ssize_t n = read(conn->fd, conn->in + conn->in_len, IN_BUF_SZ - conn->in_len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (n < 0) {
+      conn_kill(conn);
+      return;
+    }
+    if (n == 0) {
+      // A last line without a newline is still a puzzle
+      conn->eof = 1;
+      if (conn->in_len)
+        conn->in[conn->in_len++] = '\n';
+      break;
+    }
+    conn->in_len += n;
+    if (conn_full(conn))
+      break;
+  }
+  conn_flush(conn);
+}
+
+static void accept_conns(int listen_fd) {
+  for (;;) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        perror("accept");
+      if (errno != EINTR)
+        return;
+      continue;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    struct conn *conn = calloc(1, sizeof(struct conn));
+    if (!conn) {
+      perror("calloc");
+      close(fd);
+      continue;
+    }
+    conn->fd = fd;
+    conn->events = EPOLLIN;
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = conn};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+      perror("epoll_ctl");
+      close(fd);
+      free(conn);
+    }
+  }
+}
+
+// Hand finished jobs back to their connections
+static void collect_done(void) {
+  uint64_t count;
+  if (read(wake_fd, &count, sizeof(count)) < 0)
+    return;
+
+  struct job *job;
+  while ((job = jobs_take(&done, 0))) {
+    job->done = 1;
+    struct conn *conn = job->conn;
+    // Only the job at the front of the window can free up replies
+    if (conn->window[conn->emit_seq % WINDOW] == job)
+      conn_flush(conn);
+  }
+}
+
+static int listen_on(const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket");
+    return -1;
+  }
+  unlink(path);
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) || listen(fd, SOMAXCONN)) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int epoll_add(int fd, void *tag) {
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = tag};
+  return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-j threads] [-e engine] [-H strategies[:depth]] [--count[=limit]] "
+      "[-C cache entries] socket\n", name);
+  fprintf(stderr, "Engines: mrv (default), trail, backtrack, strategies, bitboard, dlx\n");
+  fprintf(stderr, "Each line sent is a puzzle; each reply is: solution result solutions backtracks us\n");
+}
+
+int main(int argc, char **argv) {
+  int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  long cache_entries = 0;
+
+  static struct option long_options[] = {
+    {"count", optional_argument, NULL, 'c'},
+    {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "C:e:H:j:", long_options, NULL)) != -1) {
+    switch (opt) {
+      case 'C': {
+        char *end;
+        cache_entries = strtol(optarg, &end, 10);
+        if (end == optarg || *end || cache_entries < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      }
+      case 'c':
+        options.limit = optarg ? atoi(optarg) : 2;
+        if (options.limit < 1) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'e': {
+        int e = 0;
+        while (e <= SUDOKU_DLX && strcmp(optarg, engine_names[e]))
+          e++;
+        if (e > SUDOKU_DLX) {
+          usage(argv[0]);
+          return 1;
+        }
+        options.engine = e;
+        break;
+      }
+      case 'H': {
+        char *depth = strchr(optarg, ':');
+        if (depth)
+          *depth++ = '\0';
+        if (sudoku_strategy_mask(optarg, &options.strategies)) {
+          fprintf(stderr, "Unknown strategy in %s\n", optarg);
+          return 1;
+        }
+        options.strategy_depth = depth ? atoi(depth) : -1;
+        break;
+      }
+      case 'j':
+        n_threads = atoi(optarg);
+        if (n_threads < 1 || n_threads > MAX_THREADS) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  const char *path = argv[optind];
+  if (cache_entries) {
+    options.cache = sudoku_cache_create(cache_entries);
+    if (!options.cache) {
+      fprintf(stderr, "Could not allocate cache\n");
+      return 1;
+    }
+  }
+  if (n_threads < 1)
+    n_threads = 1;
+  if (n_threads > MAX_THREADS)
+    n_threads = MAX_THREADS;
+
+  // Stop cleanly on SIGINT & SIGTERM, from the loop
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  int listen_fd = listen_on(path);
+  if (listen_fd < 0)
+    return 1;
+  int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (signal_fd < 0 || wake_fd < 0 || epoll_fd < 0 || epoll_add(listen_fd, &listen_tag)
+      || epoll_add(wake_fd, &wake_tag) || epoll_add(signal_fd, &signal_tag)) {
+    perror("sudokud");
+    unlink(path);
+    return 1;
+  }
+
+  // Threads inherit the blocked signals, so only signal_fd sees them
+  pthread_t threads[MAX_THREADS];
+  int started = 0;
+  for (int t = 0; t < n_threads; t++) {
+    if (pthread_create(&threads[started], NULL, worker, NULL)) {
+      perror("pthread_create");
+      break;
+    }
+    started++;
+  }
+  if (!started) {
+    unlink(path);
+    return 1;
+  }
+  fprintf(stderr, "Listening on %s with %d threads\n", path, started);
+
+  int running = 1;
+  while (running) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    if (n < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      break;
+    }
+
+    for (int k = 0; k < n; k++) {
+      void *tag = events[k].data.ptr;
+      if (tag == &listen_tag) {
+        accept_conns(listen_fd);
+      } else if (tag == &wake_tag) {
+        collect_done();
+      } else if (tag == &signal_tag) {
+        running = 0;
+      } else {
+        // A hung up client can no longer read its replies
+        struct conn *conn = tag;
+        if (conn->dead)
+          continue;
+        if (events[k].events & (EPOLLERR | EPOLLHUP))
+          conn_kill(conn);
+        else if (events[k].events & EPOLLIN)
+          conn_read(conn);
+        else if (events[k].events & EPOLLOUT)
+          conn_flush(conn);
+      }
+    }
+    reap_conns();
+  }
+
+  jobs_close(&work);
+  for (int t = 0; t < started; t++)
+    pthread_join(threads[t], NULL);
+  unlink(path);
+  fprintf(stderr, "Served %ld puzzles\n", served);
+  if (options.cache) {
+    struct sudoku_cache_stats stats;
+    sudoku_cache_stats(options.cache, &stats);
+    fprintf(stderr, "Cache: %ld hits, %ld misses, %ld skipped, %ld evictions, %ld of %ld entries\n",
+        stats.hits, stats.misses, stats.skipped, stats.evictions, stats.entries, stats.capacity);
+    sudoku_cache_destroy(options.cache);
+  }
+  return 0;
+}
+
+/* vim:set ts=2 sw=2 et: */
@@ -0,0 +1,88 @@
+/**
+ * bench_bits.c
+ *
+ * Micro-benchmark of the bit primitives in util.h against the shift loops
+ * they replaced. Run with `make bench-bits`.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../util.h"
+
+#define N_VECS (1 << 16)
+#define ROUNDS 200
+
+static uint16_t vecs[N_VECS];
+static volatile int sink;
+
+// Former bit_count: test each of 16 bits
+static int loop_count(uint16_t n) {
+	int count = 0;
+	for (int i = 0; i < 16; i++) {
+		count += (n >> i) & 1;
+	}
+	return count;
+}
+
+// Former lowest candidate search in the solvers
+static uint16_t loop_lowest(uint16_t n) {
+	uint16_t solution = 1;
+	while (!(n & solution)) {
+		solution <<= 1;
+	}
+	return solution;
+}
+
+// Former digit search in cells_str, for a single candidate
+static int loop_index(uint16_t n) {
+	int x = 1;
+	while (n >> x != 0)
+		x++;
+	return x - 1;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Run f over every vector ROUNDS times and return ns per call
+#define BENCH(f, arg) ({                                     \
+	double start = now();                                      \
+	int acc = 0;                                               \
+	for (int r = 0; r < ROUNDS; r++)                           \
+		for (int v = 0; v < N_VECS; v++)                         \
+			acc += f(arg);                                         \
+	sink = acc;                                                \
+	(now() - start) * 1e9 / ((double) ROUNDS * N_VECS);        \
+})
+
+int main() {
+	srand(1);
+	for (int v = 0; v < N_VECS; v++) {
+		vecs[v] = (rand() & 0x1ff) | 1 << (rand() % HOUSE_SZ);
+	}
+
+	for (int v = 0; v < N_VECS; v++) {
+		uint16_t n = vecs[v];
+		if (loop_count(n) != bit_count(n) || loop_lowest(n) != bit_lowest(n)
+				|| loop_index(bit_lowest(n)) != bit_index(n)) {
+			fprintf(stderr, "mismatch on %#x\n", n);
+			return 1;
+		}
+	}
+
+	printf("%-12s %10s %10s\n", "primitive", "loop ns", "bits ns");
+	double loop = BENCH(loop_count, vecs[v]);
+	double bits = BENCH(bit_count, vecs[v]);
+	printf("%-12s %10.2f %10.2f\n", "count", loop, bits);
+	loop = BENCH(loop_lowest, vecs[v]);
+	bits = BENCH(bit_lowest, vecs[v]);
+	printf("%-12s %10.2f %10.2f\n", "lowest", loop, bits);
+	loop = BENCH(loop_index, vecs[v] & -vecs[v]);
+	bits = BENCH(bit_index, vecs[v]);
+	printf("%-12s %10.2f %10.2f\n", "index", loop, bits);
+	return 0;
+}
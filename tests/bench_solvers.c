@@ -0,0 +1,456 @@
+/**
+ * bench_solvers.c
+ *
+ * Benchmark of the solver engines on the test corpora. Every puzzle is read
+ * into memory once, then each engine solves each puzzle a number of times,
+ * and the latency of each solve is recorded. Reports min, median & p99
+ * latency, puzzles per second & backtracks per puzzle and per level (the
+ * directory or list a puzzle came from) as CSV or JSON, so results can be
+ * compared across commits. Run with `make bench`.
+ */
+#include <dirent.h>
+#include <getopt.h>
+#include <glob.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "../backtrack.h"
+#include "../bitboard.h"
+#include "../exact_cover.h"
+#include "../search.h"
+#include "../strategies.h"
+#include "../util.h"
+
+#define NAME_SZ 64
+
+struct puzzle {
+	char name[NAME_SZ];
+	int level;                           // Index into levels
+	uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+};
+
+// Engine as benchmarked: solve cells in place, counting failed guesses
+// Returns nonzero if the puzzle was not solved
+struct engine {
+	const char *name;
+	int (*solve)(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks);
+};
+
+// Latency & backtracks of a set of solves
+struct summary {
+	int runs;
+	int solved;          // Puzzles solved, on their first run
+	long backtracks;     // Backtracks, on each puzzle's first run
+	double min_us;
+	double median_us;
+	double p99_us;
+	double per_sec;      // Solves per second of solving time
+};
+
+static struct puzzle *puzzles;
+static int n_puzzles;
+static char **levels;
+static int n_levels;
+
+static int json;
+static int first_row = 1;
+
+static long long now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int run_search(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks,
+		int (*engine)(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct search *search),
+		unsigned strategies) {
+	struct search search;
+	search_init(&search, 1);
+	search.strategies = strategies;
+	*backtracks = 0;
+	if (eliminate_givens(cells))
+		return 1;
+	int ret = engine(cells, &search);
+	*backtracks = search.backtracks;
+	return ret;
+}
+
+static int solve_stack_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	return run_search(cells, backtracks, solve_stack, 0);
+}
+
+static int solve_trail_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	return run_search(cells, backtracks, solve_trail, 0);
+}
+
+static int solve_mrv_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	return run_search(cells, backtracks, solve_mrv, 0);
+}
+
+static int solve_hybrid_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	return run_search(cells, backtracks, solve_mrv, STRAT_ALL);
+}
+
+static int solve_ts_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	struct grid grid;
+	*backtracks = 0;
+	if (grid_load(&grid, cells))
+		return 1;
+	int ret = grid_solve(&grid, NULL);
+	grid_store(&grid, cells);
+	return ret != 0;
+}
+
+static int solve_bt_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	*backtracks = 0;
+	backtrack_load(cells);
+	int ret = backtrack_solve(cells, backtracks);
+	backtrack_store(cells);
+	return ret;
+}
+
+static int solve_dlx_engine(uint16_t cells[HOUSE_SZ][HOUSE_SZ], int *backtracks) {
+	*backtracks = 0;
+	return dlx_count(cells, 1, backtracks) != 1 || !is_solved(cells);
+}
+
+static const struct engine engines[] = {
+	{"stack", solve_stack_engine},
+	{"trail", solve_trail_engine},
+	{"mrv", solve_mrv_engine},
+	{"hybrid", solve_hybrid_engine},
+	{"ts", solve_ts_engine},
+	{"bt-opt", solve_bt_engine},
+	{"bb", bitboard_solve},
+	{"dlx", solve_dlx_engine},
+};
+
+#define N_ENGINES ((int) (sizeof(engines) / sizeof(engines[0])))
+
+// Copy the last component of path, ignoring trailing slashes, to name
+static void base_name(const char *path, char *name) {
+	size_t end = strlen(path);
+	while (end > 1 && path[end - 1] == '/')
+		end--;
+	size_t start = end;
+	while (start > 0 && path[start - 1] != '/')
+		start--;
+	snprintf(name, NAME_SZ, "%.*s", (int) (end - start), path + start);
+}
+
+static int add_level(const char *path) {
+	levels = realloc(levels, (n_levels + 1) * sizeof(*levels));
+	levels[n_levels] = malloc(NAME_SZ);
+	base_name(path, levels[n_levels]);
+	return n_levels++;
+}
+
+// Read every puzzle in file into the corpus, at level. A file of several
+// puzzles (a list) names them by line; a file of one by the file name.
+// A packed corpus has its own levels, which replace level.
+// Returns nonzero if the file could not be read
+static int load_file(const char *path, int level) {
+	struct reader reader;
+	if (reader_open(&reader, path))
+		return 1;
+
+	int first = n_puzzles;
+	int ret;
+	uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+	while ((ret = reader_next(&reader, cells))) {
+		if (ret < 0)
+			continue;
+		const char *tag = reader_level(&reader);
+		if (tag && strcmp(tag, levels[level]))
+			level = add_level(tag);
+		if (!(n_puzzles & (n_puzzles - 1)))
+			puzzles = realloc(puzzles, (n_puzzles ? 2 * n_puzzles : 1) * sizeof(*puzzles));
+		struct puzzle *p = &puzzles[n_puzzles++];
+		p->level = level;
+		copy_cells(cells, p->cells);
+	}
+	reader_close(&reader);
+
+	char name[NAME_SZ];
+	base_name(path, name);
+	for (int k = first; k < n_puzzles; k++) {
+		if (n_puzzles - first == 1)
+			snprintf(puzzles[k].name, NAME_SZ, "%s", name);
+		else
+			snprintf(puzzles[k].name, NAME_SZ, "%.48s:%d", name, k - first + 1);
+	}
+	return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+// Load a corpus: a directory of puzzle files, or a list of puzzles
+// Returns nonzero if it could not be read
+static int load_corpus(const char *path) {
+	struct stat st;
+	if (stat(path, &st)) {
+		perror(path);
+		return 1;
+	}
+
+	int level = add_level(path);
+	if (!S_ISDIR(st.st_mode))
+		return load_file(path, level);
+
+	DIR *dir = opendir(path);
+	if (!dir) {
+		perror(path);
+		return 1;
+	}
+
+	// Sort entries so puzzles are always in the same order
+	char **names = NULL;
+	int n_names = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir))) {
+		if (entry->d_name[0] == '.')
+			continue;
+		names = realloc(names, (n_names + 1) * sizeof(*names));
+		names[n_names++] = strdup(entry->d_name);
+	}
+	closedir(dir);
+	qsort(names, n_names, sizeof(*names), compare_names);
+
+	int ret = 0;
+	for (int k = 0; k < n_names; k++) {
+		char file[4096];
+		snprintf(file, sizeof(file), "%s/%s", path, names[k]);
+		ret |= load_file(file, level);
+		free(names[k]);
+	}
+	free(names);
+	return ret;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+// Summarize n latencies in us, sorting them
+static void summarize(double *us, int n, struct summary *s) {
+	qsort(us, n, sizeof(*us), compare_doubles);
+	double total = 0;
+	for (int k = 0; k < n; k++)
+		total += us[k];
+
+	s->runs = n;
+	s->min_us = n ? us[0] : 0;
+	s->median_us = n ? us[(n - 1) / 2] : 0;
+	s->p99_us = n ? us[(99 * n + 99) / 100 - 1] : 0;
+	s->per_sec = total > 0 ? n * 1e6 / total : 0;
+}
+
+static void print_header(int reps) {
+	if (json)
+		printf("{\"reps\": %d, \"results\": [\n", reps);
+	else
+		printf("engine,level,puzzle,runs,solved,backtracks,min_us,median_us,p99_us,puzzles_per_sec\n");
+}
+
+// Print a summary. Level rows have a NULL puzzle.
+static void print_row(const char *engine, const char *level, const char *puzzle,
+		const struct summary *s) {
+	if (!json) {
+		printf("%s,%s,%s,%d,%d,%ld,%.3f,%.3f,%.3f,%.1f\n", engine, level,
+				puzzle ? puzzle : "", s->runs, s->solved, s->backtracks,
+				s->min_us, s->median_us, s->p99_us, s->per_sec);
+		return;
+	}
+
+	printf("%s  {\"engine\": \"%s\", \"level\": \"%s\", ", first_row ? "" : ",\n",
+			engine, level);
+	if (puzzle)
+		printf("\"puzzle\": \"%s\", ", puzzle);
+	else
+		printf("\"puzzle\": null, ");
+	printf("\"runs\": %d, \"solved\": %d, \"backtracks\": %ld, \"min_us\": %.3f, "
+			"\"median_us\": %.3f, \"p99_us\": %.3f, \"puzzles_per_sec\": %.1f}",
+			s->runs, s->solved, s->backtracks, s->min_us, s->median_us, s->p99_us,
+			s->per_sec);
+	first_row = 0;
+}
+
+static void print_footer(void) {
+	if (json)
+		printf("\n]}\n");
+}
+
+// Solve every puzzle reps times with engine and print its rows
+static void bench_engine(const struct engine *engine, int reps, int per_puzzle) {
+	double *us = malloc((size_t) n_puzzles * reps * sizeof(*us));
+	int *solved = malloc(n_puzzles * sizeof(*solved));
+	int *backtracks = malloc(n_puzzles * sizeof(*backtracks));
+
+	// Each round solves the whole corpus once
+	for (int r = 0; r < reps; r++) {
+		for (int p = 0; p < n_puzzles; p++) {
+			uint16_t cells[HOUSE_SZ][HOUSE_SZ];
+			copy_cells(puzzles[p].cells, cells);
+			int bt;
+			long long start = now_ns();
+			int ret = engine->solve(cells, &bt);
+			us[p * reps + r] = (now_ns() - start) / 1e3;
+			if (!r) {
+				solved[p] = !ret;
+				backtracks[p] = bt;
+			}
+		}
+	}
+
+	struct summary s;
+	if (per_puzzle) {
+		for (int p = 0; p < n_puzzles; p++) {
+			double sorted[reps];
+			memcpy(sorted, &us[p * reps], sizeof(sorted));
+			summarize(sorted, reps, &s);
+			s.solved = solved[p];
+			s.backtracks = backtracks[p];
+			print_row(engine->name, levels[puzzles[p].level], puzzles[p].name, &s);
+		}
+	}
+
+	// Levels, then every puzzle as level "all"
+	double *level_us = malloc((size_t) n_puzzles * reps * sizeof(*level_us));
+	for (int l = 0; l <= n_levels; l++) {
+		int n = 0;
+		long level_backtracks = 0;
+		int level_solved = 0;
+		for (int p = 0; p < n_puzzles; p++) {
+			if (l < n_levels && puzzles[p].level != l)
+				continue;
+			memcpy(&level_us[n], &us[p * reps], reps * sizeof(*us));
+			n += reps;
+			level_backtracks += backtracks[p];
+			level_solved += solved[p];
+		}
+		if (!n || (l == n_levels && n_levels == 1))
+			continue;
+
+		summarize(level_us, n, &s);
+		s.solved = level_solved;
+		s.backtracks = level_backtracks;
+		print_row(engine->name, l < n_levels ? levels[l] : "all", NULL, &s);
+	}
+
+	free(level_us);
+	free(backtracks);
+	free(solved);
+	free(us);
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-e engines] [-n reps] [-f csv|json] [-L] [corpus ...]\n", name);
+	fprintf(stderr, "A corpus is a directory of puzzle files or a list of puzzles, one per line\n");
+	fprintf(stderr, "(default tests/ai and tests/se*)\n");
+	fprintf(stderr, "  -e  comma-separated engines (default all):");
+	for (int e = 0; e < N_ENGINES; e++)
+		fprintf(stderr, " %s", engines[e].name);
+	fprintf(stderr, "\n  -n  solves of each puzzle by each engine (default 5)\n");
+	fprintf(stderr, "  -L  print levels only, not each puzzle\n");
+}
+
+// Parse comma-separated engine names into a mask of engines[]
+// Returns nonzero if a name is not an engine
+static int engine_mask_parse(const char *names, unsigned *mask) {
+	*mask = 0;
+	while (*names) {
+		size_t len = strcspn(names, ",");
+		int e;
+		for (e = 0; e < N_ENGINES; e++) {
+			if (strlen(engines[e].name) == len && !strncmp(engines[e].name, names, len))
+				break;
+		}
+		if (e == N_ENGINES)
+			return 1;
+
+		*mask |= 1u << e;
+		names += len;
+		if (*names == ',')
+			names++;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	unsigned mask = (1u << N_ENGINES) - 1;
+	int reps = 5;
+	int per_puzzle = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "e:f:Ln:")) != -1) {
+		switch (opt) {
+			case 'e':
+				if (engine_mask_parse(optarg, &mask)) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'f':
+				if (strcmp(optarg, "csv") && strcmp(optarg, "json")) {
+					usage(argv[0]);
+					return 1;
+				}
+				json = !strcmp(optarg, "json");
+				break;
+			case 'L':
+				per_puzzle = 0;
+				break;
+			case 'n':
+				reps = atoi(optarg);
+				if (reps < 1) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind < argc) {
+		for (int k = optind; k < argc; k++) {
+			if (load_corpus(argv[k]))
+				return 1;
+		}
+	} else {
+		if (load_corpus("tests/ai"))
+			return 1;
+		glob_t g;
+		if (!glob("tests/se*", GLOB_ONLYDIR, NULL, &g)) {
+			for (size_t k = 0; k < g.gl_pathc; k++) {
+				if (load_corpus(g.gl_pathv[k]))
+					return 1;
+			}
+			globfree(&g);
+		}
+	}
+
+	if (!n_puzzles) {
+		fprintf(stderr, "No puzzles found\n");
+		return 1;
+	}
+
+	bitboard_init();
+	dlx_init();
+
+	print_header(reps);
+	for (int e = 0; e < N_ENGINES; e++) {
+		if (mask & (1u << e))
+			bench_engine(&engines[e], reps, per_puzzle);
+	}
+	print_footer();
+	return 0;
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Convert puzzle corpora to the packed format the solvers read (see util.h).
+
+Each input becomes one level, or several for a clean.py source file:
+  directory   one puzzle per file, as nine lines of nine digits (tests/se*);
+              the level is the directory name
+  source      clean.py's input, lines of hash, puzzle, clue count and rating;
+              levels are se<rating> as clean.py names its directories
+  list        one 81-digit puzzle per line; the level is the file name
+
+./pack.py -o corpus.pack tests/ai tests/se*    packs the test corpora
+./pack.py -d corpus.pack                       lists a packed corpus
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"SDKP"
+VERSION = 1
+TAG_SZ = 12
+N_CELLS = 81
+
+
+def parse_puzzle(text):
+    digits = "".join(text.split()).replace(".", "0")
+    if len(digits) != N_CELLS or not digits.isdigit():
+        return None
+    return digits
+
+
+def pack_puzzle(digits):
+    cells = [int(d) for d in digits] + [0]
+    return bytes(cells[n] | cells[n + 1] << 4 for n in range(0, N_CELLS, 2))
+
+
+def unpack_puzzle(data):
+    return "".join("%d%d" % (b & 0xf, b >> 4) for b in data)[:N_CELLS]
+
+
+def read_directory(path):
+    puzzles = []
+    for name in sorted(os.listdir(path)):
+        with open(os.path.join(path, name)) as f:
+            digits = parse_puzzle(f.read())
+        if digits:
+            puzzles.append(digits)
+        else:
+            print("Skipping malformed %s" % os.path.join(path, name), file=sys.stderr)
+    return [(os.path.basename(os.path.normpath(path)), puzzles)]
+
+
+def read_file(path):
+    levels = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 4:
+                # hash puzzle clues rating, as clean.py reads
+                level = fields[3].split(".")
+                tag = "se" + level[0] + "_" + level[1]
+                digits = parse_puzzle(fields[1])
+            elif len(fields) == 1:
+                tag = os.path.basename(path)
+                digits = parse_puzzle(fields[0])
+            elif not fields:
+                continue
+            else:
+                digits = None
+            if digits:
+                levels.setdefault(tag, []).append(digits)
+            else:
+                print("Skipping malformed line in %s: %s" % (path, line.strip()), file=sys.stderr)
+    return sorted(levels.items())
+
+
+def pack(inputs, out):
+    levels = []
+    for path in inputs:
+        levels += read_directory(path) if os.path.isdir(path) else read_file(path)
+
+    if len(levels) > 255:
+        sys.exit("Too many levels: %d" % len(levels))
+
+    n_puzzles = sum(len(puzzles) for _, puzzles in levels)
+    out.write(struct.pack("<4sBBHI", MAGIC, VERSION, len(levels), 0, n_puzzles))
+    first = 0
+    for tag, puzzles in levels:
+        if len(tag) >= TAG_SZ:
+            sys.exit("Level tag too long: %s" % tag)
+        out.write(struct.pack("<%dsII" % TAG_SZ, tag.encode(), first, len(puzzles)))
+        first += len(puzzles)
+    for _, puzzles in levels:
+        for digits in puzzles:
+            out.write(pack_puzzle(digits))
+    print("Packed %d puzzles in %d levels" % (n_puzzles, len(levels)), file=sys.stderr)
+
+
+def dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, n_levels, _, n_puzzles = struct.unpack_from("<4sBBHI", data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit("%s is not a packed corpus" % path)
+
+    pos = 12 + n_levels * (TAG_SZ + 8)
+    size = (N_CELLS + 1) // 2
+    for l in range(n_levels):
+        tag, first, count = struct.unpack_from("<%dsII" % TAG_SZ, data, 12 + l * (TAG_SZ + 8))
+        tag = tag.rstrip(b"\0").decode()
+        for k in range(first, first + count):
+            print(tag, unpack_puzzle(data[pos + k * size:pos + (k + 1) * size]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", help="packed corpus to write (default stdout)")
+    parser.add_argument("-d", "--dump", action="store_true", help="list the puzzles of a packed corpus")
+    parser.add_argument("inputs", nargs="+")
+    args = parser.parse_args()
+
+    if args.dump:
+        for path in args.inputs:
+            dump(path)
+    elif args.output:
+        with open(args.output, "wb") as out:
+            pack(args.inputs, out)
+    else:
+        pack(args.inputs, sys.stdout.buffer)
+
+
+if __name__ == "__main__":
+    main()
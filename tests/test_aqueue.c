@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../util.h"
+
+struct aqueue queue;
+
+void test_is_empty() {
+	aqueue_init(&queue, 4);
+	assert(aqueue_is_empty(&queue));
+	int datum = 71;
+	aqueue_put(&queue, &datum);
+	assert(!aqueue_is_empty(&queue));
+	aqueue_destroy(&queue);
+}
+
+void test_spurious_remove() {
+	aqueue_init(&queue, 4);
+	void *datum = aqueue_get(&queue);
+	assert(datum == NULL);
+	aqueue_destroy(&queue);
+}
+
+void test_get_remove() {
+	aqueue_init(&queue, 4);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	// Grows past initial size
+	for (int i = 0; i < 10; i++) {
+		aqueue_put(&queue, &data[i]);
+	}
+
+	for (int i = 0; i < 10; i++) {
+		assert(aqueue_get(&queue) == &data[i]);
+	}
+	assert(aqueue_is_empty(&queue));
+
+	aqueue_destroy(&queue);
+}
+
+void test_grow_wrapped() {
+	aqueue_init(&queue, 4);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	// Move head partway around the array before growing
+	for (int i = 0; i < 3; i++) {
+		aqueue_put(&queue, &data[i]);
+	}
+	for (int i = 0; i < 3; i++) {
+		assert(aqueue_get(&queue) == &data[i]);
+	}
+
+	for (int i = 0; i < 10; i++) {
+		aqueue_put(&queue, &data[i]);
+	}
+
+	for (int i = 0; i < 10; i++) {
+		assert(aqueue_get(&queue) == &data[i]);
+	}
+
+	aqueue_destroy(&queue);
+}
+
+void test_alternate() {
+	aqueue_init(&queue, 1);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	for (int i = 0; i < 10; i++) {
+		aqueue_put(&queue, &data[i]);
+		if (i % 3 == 0) {
+			assert(aqueue_get(&queue) == &data[i / 3]);
+		}
+	}
+
+	aqueue_destroy(&queue);
+}
+
+void test_reset() {
+	aqueue_init(&queue, 4);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	for (int i = 0; i < 10; i++) {
+		aqueue_put(&queue, &data[i]);
+	}
+	aqueue_get(&queue);
+
+	aqueue_reset(&queue);
+	assert(aqueue_is_empty(&queue));
+	aqueue_put(&queue, &data[5]);
+	assert(aqueue_get(&queue) == &data[5]);
+
+	aqueue_destroy(&queue);
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../util.h"
+
+struct astack stack;
+
+void test_is_empty() {
+	astack_init(&stack, 4);
+	assert(astack_is_empty(&stack));
+	int datum = 71;
+	astack_push(&stack, &datum);
+	assert(!astack_is_empty(&stack));
+	astack_destroy(&stack);
+}
+
+void test_spurious_pop() {
+	astack_init(&stack, 4);
+	void *datum = astack_pop(&stack);
+	assert(datum == NULL);
+	astack_destroy(&stack);
+}
+
+void test_push_pop() {
+	astack_init(&stack, 4);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	// Grows past initial size
+	for (int i = 0; i < 10; i++) {
+		astack_push(&stack, &data[i]);
+	}
+
+	for (int i = 9; i >= 0; i--) {
+		assert(astack_pop(&stack) == &data[i]);
+	}
+	assert(astack_is_empty(&stack));
+
+	astack_destroy(&stack);
+}
+
+void test_alternate() {
+	astack_init(&stack, 1);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	for (int i = 0; i < 10; i++) {
+		astack_push(&stack, &data[i]);
+		if (i % 3 == 0) {
+			assert(astack_pop(&stack) == &data[i]);
+		}
+	}
+
+	astack_destroy(&stack);
+}
+
+void test_reset() {
+	astack_init(&stack, 4);
+	int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	for (int i = 0; i < 10; i++) {
+		astack_push(&stack, &data[i]);
+	}
+
+	// Storage is kept, so pushing up to the old size doesn't reallocate
+	void **array = stack.array;
+	astack_reset(&stack);
+	assert(astack_is_empty(&stack));
+	for (int i = 0; i < 10; i++) {
+		astack_push(&stack, &data[i]);
+	}
+	assert(stack.array == array);
+	assert(astack_pop(&stack) == &data[9]);
+
+	astack_destroy(&stack);
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <assert.h>
+#include "../util.h"
+
+struct ipq pq;
+
+// Extract all keys, checking priorities never increase
+static void assert_drains_in_order() {
+	int max = -1;
+	while (!ipq_is_empty(&pq)) {
+		int key = ipq_extract_max(&pq);
+		if (max >= 0)
+			assert(pq.priority[key] <= pq.priority[max]);
+		max = key;
+	}
+}
+
+void test_is_empty() {
+	ipq_init(&pq, 10);
+	assert(ipq_is_empty(&pq));
+	ipq_insert(&pq, 7, 71);
+	assert(!ipq_is_empty(&pq));
+	assert(ipq_contains(&pq, 7));
+	assert(!ipq_contains(&pq, 6));
+	ipq_destroy(&pq);
+}
+
+void test_spurious_extract() {
+	ipq_init(&pq, 10);
+	assert(ipq_extract_max(&pq) == -1);
+	ipq_destroy(&pq);
+}
+
+void test_duplicate_insert() {
+	ipq_init(&pq, 10);
+	assert(ipq_insert(&pq, 3, 1) == 0);
+	assert(ipq_insert(&pq, 3, 2) == 1);
+	assert(ipq_insert(&pq, 10, 2) == 1);
+	assert(ipq_extract_max(&pq) == 3);
+	assert(ipq_is_empty(&pq));
+	ipq_destroy(&pq);
+}
+
+void test_insert_low2high() {
+	ipq_init(&pq, 10);
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, i);
+	}
+
+	for (int i = 9; i >= 0; i--) {
+		assert(ipq_extract_max(&pq) == i);
+		assert(!ipq_contains(&pq, i));
+	}
+	ipq_destroy(&pq);
+}
+
+void test_insert_high2low() {
+	ipq_init(&pq, 10);
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, 9 - i);
+	}
+
+	for (int i = 0; i < 10; i++) {
+		assert(ipq_extract_max(&pq) == i);
+	}
+	ipq_destroy(&pq);
+}
+
+void test_alternate() {
+	ipq_init(&pq, 10);
+	int priorities[10] = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, priorities[i]);
+		if (i % 3) {
+			ipq_extract_max(&pq);
+		}
+	}
+
+	assert_drains_in_order();
+	ipq_destroy(&pq);
+}
+
+void test_decrease_key() {
+	ipq_init(&pq, 10);
+	int priorities[10] = {0, 1, 2, 3, 9, 5, 6, 7, 8, 9};
+
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, priorities[i]);
+	}
+
+	ipq_change_key(&pq, 4, 4);
+	assert(pq.priority[4] == 4);
+	assert(ipq_extract_max(&pq) == 9);
+	assert(ipq_extract_max(&pq) == 8);
+
+	assert_drains_in_order();
+	ipq_destroy(&pq);
+}
+
+void test_increase_key() {
+	ipq_init(&pq, 10);
+	int priorities[10] = {0, 1, 2, 3, 0, 5, 6, 7, 8, 9};
+
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, priorities[i]);
+	}
+
+	ipq_change_key(&pq, 4, 10);
+	assert(ipq_extract_max(&pq) == 4);
+
+	// Keys not queued are ignored
+	ipq_change_key(&pq, 4, 20);
+	assert(!ipq_contains(&pq, 4));
+
+	assert_drains_in_order();
+	ipq_destroy(&pq);
+}
+
+void test_reinsert() {
+	ipq_init(&pq, 10);
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, i % 4);
+	}
+
+	int key = ipq_extract_max(&pq);
+	assert(pq.priority[key] == 3);
+	ipq_insert(&pq, key, 5);
+	assert(ipq_extract_max(&pq) == key);
+
+	assert_drains_in_order();
+	ipq_destroy(&pq);
+}
+
+void test_init_buf() {
+	int buf[3 * 10];
+	ipq_init_buf(&pq, 10, buf);
+	assert(ipq_is_empty(&pq));
+	for (int i = 0; i < 10; i++) {
+		ipq_insert(&pq, i, i);
+	}
+	assert(ipq_extract_max(&pq) == 9);
+	assert_drains_in_order();
+}
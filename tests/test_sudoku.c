@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "../sudoku.h"
+
+// Solved by singles alone
+static const char *easy =
+	"070000090403010208600709003700080004900000005060000020006000300300408007080263040";
+static const char *easy_solution =
+	"275834196493516278618729453751682934932147865864395721546971382329458617187263549";
+
+// AI Escargot: needs search
+static const char *hard =
+	"100007090030020008009600500005300900010080002600004000300000010040000007007000300";
+static const char *hard_solution =
+	"162857493534129678789643521475312986913586742628794135356478219241935867897261354";
+
+// Many solutions
+static const char *open =
+	"400060070000000600000002001000008500010400000020950000000000705000000030003040080";
+
+void test_default_engine() {
+	char out[82];
+	struct sudoku_stats stats;
+	assert(sudoku_solve(hard, out, NULL, &stats) == SUDOKU_SOLVED);
+	assert(!strcmp(out, hard_solution));
+	assert(stats.solutions == 1);
+}
+
+void test_every_engine() {
+	for (int e = SUDOKU_MRV; e <= SUDOKU_DLX; e++) {
+		if (e == SUDOKU_STRATEGIES)
+			continue;
+
+		char out[82];
+		struct sudoku_options options = {e, 1, 0, -1};
+		assert(sudoku_solve(hard, out, &options, NULL) == SUDOKU_SOLVED);
+		assert(!strcmp(out, hard_solution));
+	}
+}
+
+void test_strategies() {
+	char out[82];
+	struct sudoku_stats stats;
+	struct sudoku_options options = {SUDOKU_STRATEGIES, 1, 0, -1};
+	assert(sudoku_solve(easy, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(!strcmp(out, easy_solution));
+	assert(stats.rating >= 1.0 && stats.rating < 2.0);
+
+	// Stalls, leaving unsolved cells as 0
+	assert(sudoku_solve(hard, out, &options, &stats) == SUDOKU_UNSOLVED);
+	assert(strchr(out, '0'));
+	assert(stats.rating >= 1.0 && stats.rating < 9.0);
+}
+
+void test_hybrid() {
+	char out[82];
+	struct sudoku_options options = {SUDOKU_MRV, 1, SUDOKU_STRATEGIES_ALL, 0};
+	assert(sudoku_strategy_mask("singles,x_wing", &options.strategies) == 0);
+	assert(sudoku_strategy_mask("no_such_strategy", &options.strategies) != 0);
+	options.strategies = SUDOKU_STRATEGIES_ALL;
+	assert(sudoku_solve(hard, out, &options, NULL) == SUDOKU_SOLVED);
+	assert(!strcmp(out, hard_solution));
+}
+
+void test_count() {
+	struct sudoku_stats stats;
+	int engines[] = {SUDOKU_MRV, SUDOKU_TRAIL, SUDOKU_DLX};
+	for (int k = 0; k < 3; k++) {
+		struct sudoku_options options = {engines[k], 2, 0, -1};
+		assert(sudoku_solve(hard, NULL, &options, &stats) == SUDOKU_SOLVED);
+		assert(stats.solutions == 1);
+		assert(sudoku_solve(open, NULL, &options, &stats) == SUDOKU_MULTIPLE);
+		assert(stats.solutions == 2);
+	}
+}
+
+void test_empty_cells() {
+	char in[82];
+	char out[82];
+	strcpy(in, hard);
+	for (int n = 0; n < 81; n++) {
+		if (in[n] == '0')
+			in[n] = '.';
+	}
+	assert(sudoku_solve(in, out, NULL, NULL) == SUDOKU_SOLVED);
+	assert(!strcmp(out, hard_solution));
+}
+
+void test_invalid() {
+	char in[82];
+	char out[82];
+	assert(sudoku_solve("123", out, NULL, NULL) == SUDOKU_INVALID);
+	strcpy(in, hard);
+	in[40] = 'x';
+	assert(sudoku_solve(in, out, NULL, NULL) == SUDOKU_INVALID);
+
+	struct sudoku_options options = {SUDOKU_DLX + 1, 1, 0, -1};
+	assert(sudoku_solve(hard, out, &options, NULL) == SUDOKU_INVALID);
+}
+
+void test_contradiction() {
+	char in[82];
+	char out[82];
+	strcpy(in, hard);
+	in[1] = '1';  // Same row as the 1 in cell 0
+	for (int e = SUDOKU_MRV; e <= SUDOKU_DLX; e++) {
+		struct sudoku_options options = {e, 1, 0, -1};
+		assert(sudoku_solve(in, out, &options, NULL) == SUDOKU_UNSOLVED);
+	}
+}
+
+// Transpose puzzle and swap digits d and 10 - d, into out
+static void transform(const char *puzzle, char *out) {
+	for (int i = 0; i < 9; i++) {
+		for (int j = 0; j < 9; j++) {
+			char c = puzzle[j * 9 + i];
+			out[i * 9 + j] = c == '0' ? '0' : '0' + 10 - (c - '0');
+		}
+	}
+	out[81] = '\0';
+}
+
+void test_cache() {
+	char in[82];
+	char out[82];
+	char expected[82];
+	struct sudoku_stats stats;
+	struct sudoku_cache_stats cache_stats;
+	struct sudoku_cache *cache = sudoku_cache_create(2);
+	assert(cache);
+	struct sudoku_options options = {SUDOKU_MRV, 1, 0, -1, cache};
+
+	assert(sudoku_solve(hard, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(!stats.cached);
+	assert(!strcmp(out, hard_solution));
+
+	// Equivalent puzzles hit, and get their own solution back
+	transform(hard, in);
+	transform(hard_solution, expected);
+	assert(sudoku_solve(in, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(stats.cached);
+	assert(stats.solutions == 1);
+	assert(!strcmp(out, expected));
+
+	// Results are kept per solution limit
+	options.limit = 2;
+	assert(sudoku_solve(open, out, &options, &stats) == SUDOKU_MULTIPLE);
+	assert(!stats.cached);
+	assert(sudoku_solve(open, NULL, &options, &stats) == SUDOKU_MULTIPLE);
+	assert(stats.cached);
+	assert(stats.solutions == 2);
+
+	sudoku_cache_stats(cache, &cache_stats);
+	assert(cache_stats.hits == 2);
+	assert(cache_stats.misses == 2);
+	assert(cache_stats.entries == 2);
+	assert(cache_stats.evictions == 0);
+
+	// The least recently used result goes first
+	options.limit = 1;
+	assert(sudoku_solve(easy, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(sudoku_solve(hard, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(!stats.cached);
+	sudoku_cache_stats(cache, &cache_stats);
+	assert(cache_stats.evictions == 2);
+	assert(cache_stats.entries == 2);
+
+	// No solution is a result too
+	strcpy(in, hard);
+	in[1] = '1';
+	assert(sudoku_solve(in, out, &options, &stats) == SUDOKU_UNSOLVED);
+	assert(sudoku_solve(in, out, &options, &stats) == SUDOKU_UNSOLVED);
+	assert(stats.cached);
+	assert(!strcmp(out, in));
+
+	// Sparse & highly symmetric grids are solved without the cache
+	memset(in, '0', 81);
+	in[81] = '\0';
+	in[40] = '5';
+	assert(sudoku_solve(in, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(!stats.cached);
+	assert(sudoku_solve(hard_solution, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(sudoku_solve(hard_solution, out, &options, &stats) == SUDOKU_SOLVED);
+	assert(!stats.cached);
+	sudoku_cache_stats(cache, &cache_stats);
+	assert(cache_stats.skipped == 3);
+
+	sudoku_cache_destroy(cache);
+}
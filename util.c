@@ -5,22 +5,139 @@
  * @author Grace-H
  */
 
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "instr.h"
 #include "util.h"
 
-// Count number of set bits in vector of size uint16_t (unsigned short)
-int bit_count(const uint16_t n) {
-  int count = 0;
-  for (int i = 0; i < 16; i++) {
-    count += (n >> i) & 1;
-  }
-  return count;
-}
+// Peers of each cell: the 8 others in its row, the 8 others in its column,
+// then the 4 in its block that share neither
+const uint8_t peers[N_CELLS][N_PEERS] = {
+  { 1,  2,  3,  4,  5,  6,  7,  8,  9, 18, 27, 36, 45, 54, 63, 72, 10, 11, 19, 20}, // 0,0
+  { 0,  2,  3,  4,  5,  6,  7,  8, 10, 19, 28, 37, 46, 55, 64, 73,  9, 11, 18, 20}, // 0,1
+  { 0,  1,  3,  4,  5,  6,  7,  8, 11, 20, 29, 38, 47, 56, 65, 74,  9, 10, 18, 19}, // 0,2
+  { 0,  1,  2,  4,  5,  6,  7,  8, 12, 21, 30, 39, 48, 57, 66, 75, 13, 14, 22, 23}, // 0,3
+  { 0,  1,  2,  3,  5,  6,  7,  8, 13, 22, 31, 40, 49, 58, 67, 76, 12, 14, 21, 23}, // 0,4
+  { 0,  1,  2,  3,  4,  6,  7,  8, 14, 23, 32, 41, 50, 59, 68, 77, 12, 13, 21, 22}, // 0,5
+  { 0,  1,  2,  3,  4,  5,  7,  8, 15, 24, 33, 42, 51, 60, 69, 78, 16, 17, 25, 26}, // 0,6
+  { 0,  1,  2,  3,  4,  5,  6,  8, 16, 25, 34, 43, 52, 61, 70, 79, 15, 17, 24, 26}, // 0,7
+  { 0,  1,  2,  3,  4,  5,  6,  7, 17, 26, 35, 44, 53, 62, 71, 80, 15, 16, 24, 25}, // 0,8
+  {10, 11, 12, 13, 14, 15, 16, 17,  0, 18, 27, 36, 45, 54, 63, 72,  1,  2, 19, 20}, // 1,0
+  { 9, 11, 12, 13, 14, 15, 16, 17,  1, 19, 28, 37, 46, 55, 64, 73,  0,  2, 18, 20}, // 1,1
+  { 9, 10, 12, 13, 14, 15, 16, 17,  2, 20, 29, 38, 47, 56, 65, 74,  0,  1, 18, 19}, // 1,2
+  { 9, 10, 11, 13, 14, 15, 16, 17,  3, 21, 30, 39, 48, 57, 66, 75,  4,  5, 22, 23}, // 1,3
+  { 9, 10, 11, 12, 14, 15, 16, 17,  4, 22, 31, 40, 49, 58, 67, 76,  3,  5, 21, 23}, // 1,4
+  { 9, 10, 11, 12, 13, 15, 16, 17,  5, 23, 32, 41, 50, 59, 68, 77,  3,  4, 21, 22}, // 1,5
+  { 9, 10, 11, 12, 13, 14, 16, 17,  6, 24, 33, 42, 51, 60, 69, 78,  7,  8, 25, 26}, // 1,6
+  { 9, 10, 11, 12, 13, 14, 15, 17,  7, 25, 34, 43, 52, 61, 70, 79,  6,  8, 24, 26}, // 1,7
+  { 9, 10, 11, 12, 13, 14, 15, 16,  8, 26, 35, 44, 53, 62, 71, 80,  6,  7, 24, 25}, // 1,8
+  {19, 20, 21, 22, 23, 24, 25, 26,  0,  9, 27, 36, 45, 54, 63, 72,  1,  2, 10, 11}, // 2,0
+  {18, 20, 21, 22, 23, 24, 25, 26,  1, 10, 28, 37, 46, 55, 64, 73,  0,  2,  9, 11}, // 2,1
+  {18, 19, 21, 22, 23, 24, 25, 26,  2, 11, 29, 38, 47, 56, 65, 74,  0,  1,  9, 10}, // 2,2
+  {18, 19, 20, 22, 23, 24, 25, 26,  3, 12, 30, 39, 48, 57, 66, 75,  4,  5, 13, 14}, // 2,3
+  {18, 19, 20, 21, 23, 24, 25, 26,  4, 13, 31, 40, 49, 58, 67, 76,  3,  5, 12, 14}, // 2,4
+  {18, 19, 20, 21, 22, 24, 25, 26,  5, 14, 32, 41, 50, 59, 68, 77,  3,  4, 12, 13}, // 2,5
+  {18, 19, 20, 21, 22, 23, 25, 26,  6, 15, 33, 42, 51, 60, 69, 78,  7,  8, 16, 17}, // 2,6
+  {18, 19, 20, 21, 22, 23, 24, 26,  7, 16, 34, 43, 52, 61, 70, 79,  6,  8, 15, 17}, // 2,7
+  {18, 19, 20, 21, 22, 23, 24, 25,  8, 17, 35, 44, 53, 62, 71, 80,  6,  7, 15, 16}, // 2,8
+  {28, 29, 30, 31, 32, 33, 34, 35,  0,  9, 18, 36, 45, 54, 63, 72, 37, 38, 46, 47}, // 3,0
+  {27, 29, 30, 31, 32, 33, 34, 35,  1, 10, 19, 37, 46, 55, 64, 73, 36, 38, 45, 47}, // 3,1
+  {27, 28, 30, 31, 32, 33, 34, 35,  2, 11, 20, 38, 47, 56, 65, 74, 36, 37, 45, 46}, // 3,2
+  {27, 28, 29, 31, 32, 33, 34, 35,  3, 12, 21, 39, 48, 57, 66, 75, 40, 41, 49, 50}, // 3,3
+  {27, 28, 29, 30, 32, 33, 34, 35,  4, 13, 22, 40, 49, 58, 67, 76, 39, 41, 48, 50}, // 3,4
+  {27, 28, 29, 30, 31, 33, 34, 35,  5, 14, 23, 41, 50, 59, 68, 77, 39, 40, 48, 49}, // 3,5
+  {27, 28, 29, 30, 31, 32, 34, 35,  6, 15, 24, 42, 51, 60, 69, 78, 43, 44, 52, 53}, // 3,6
+  {27, 28, 29, 30, 31, 32, 33, 35,  7, 16, 25, 43, 52, 61, 70, 79, 42, 44, 51, 53}, // 3,7
+  {27, 28, 29, 30, 31, 32, 33, 34,  8, 17, 26, 44, 53, 62, 71, 80, 42, 43, 51, 52}, // 3,8
+  {37, 38, 39, 40, 41, 42, 43, 44,  0,  9, 18, 27, 45, 54, 63, 72, 28, 29, 46, 47}, // 4,0
+  {36, 38, 39, 40, 41, 42, 43, 44,  1, 10, 19, 28, 46, 55, 64, 73, 27, 29, 45, 47}, // 4,1
+  {36, 37, 39, 40, 41, 42, 43, 44,  2, 11, 20, 29, 47, 56, 65, 74, 27, 28, 45, 46}, // 4,2
+  {36, 37, 38, 40, 41, 42, 43, 44,  3, 12, 21, 30, 48, 57, 66, 75, 31, 32, 49, 50}, // 4,3
+  {36, 37, 38, 39, 41, 42, 43, 44,  4, 13, 22, 31, 49, 58, 67, 76, 30, 32, 48, 50}, // 4,4
+  {36, 37, 38, 39, 40, 42, 43, 44,  5, 14, 23, 32, 50, 59, 68, 77, 30, 31, 48, 49}, // 4,5
+  {36, 37, 38, 39, 40, 41, 43, 44,  6, 15, 24, 33, 51, 60, 69, 78, 34, 35, 52, 53}, // 4,6
+  {36, 37, 38, 39, 40, 41, 42, 44,  7, 16, 25, 34, 52, 61, 70, 79, 33, 35, 51, 53}, // 4,7
+  {36, 37, 38, 39, 40, 41, 42, 43,  8, 17, 26, 35, 53, 62, 71, 80, 33, 34, 51, 52}, // 4,8
+  {46, 47, 48, 49, 50, 51, 52, 53,  0,  9, 18, 27, 36, 54, 63, 72, 28, 29, 37, 38}, // 5,0
+  {45, 47, 48, 49, 50, 51, 52, 53,  1, 10, 19, 28, 37, 55, 64, 73, 27, 29, 36, 38}, // 5,1
+  {45, 46, 48, 49, 50, 51, 52, 53,  2, 11, 20, 29, 38, 56, 65, 74, 27, 28, 36, 37}, // 5,2
+  {45, 46, 47, 49, 50, 51, 52, 53,  3, 12, 21, 30, 39, 57, 66, 75, 31, 32, 40, 41}, // 5,3
+  {45, 46, 47, 48, 50, 51, 52, 53,  4, 13, 22, 31, 40, 58, 67, 76, 30, 32, 39, 41}, // 5,4
+  {45, 46, 47, 48, 49, 51, 52, 53,  5, 14, 23, 32, 41, 59, 68, 77, 30, 31, 39, 40}, // 5,5
+  {45, 46, 47, 48, 49, 50, 52, 53,  6, 15, 24, 33, 42, 60, 69, 78, 34, 35, 43, 44}, // 5,6
+  {45, 46, 47, 48, 49, 50, 51, 53,  7, 16, 25, 34, 43, 61, 70, 79, 33, 35, 42, 44}, // 5,7
+  {45, 46, 47, 48, 49, 50, 51, 52,  8, 17, 26, 35, 44, 62, 71, 80, 33, 34, 42, 43}, // 5,8
+  {55, 56, 57, 58, 59, 60, 61, 62,  0,  9, 18, 27, 36, 45, 63, 72, 64, 65, 73, 74}, // 6,0
+  {54, 56, 57, 58, 59, 60, 61, 62,  1, 10, 19, 28, 37, 46, 64, 73, 63, 65, 72, 74}, // 6,1
+  {54, 55, 57, 58, 59, 60, 61, 62,  2, 11, 20, 29, 38, 47, 65, 74, 63, 64, 72, 73}, // 6,2
+  {54, 55, 56, 58, 59, 60, 61, 62,  3, 12, 21, 30, 39, 48, 66, 75, 67, 68, 76, 77}, // 6,3
+  {54, 55, 56, 57, 59, 60, 61, 62,  4, 13, 22, 31, 40, 49, 67, 76, 66, 68, 75, 77}, // 6,4
+  {54, 55, 56, 57, 58, 60, 61, 62,  5, 14, 23, 32, 41, 50, 68, 77, 66, 67, 75, 76}, // 6,5
+  {54, 55, 56, 57, 58, 59, 61, 62,  6, 15, 24, 33, 42, 51, 69, 78, 70, 71, 79, 80}, // 6,6
+  {54, 55, 56, 57, 58, 59, 60, 62,  7, 16, 25, 34, 43, 52, 70, 79, 69, 71, 78, 80}, // 6,7
+  {54, 55, 56, 57, 58, 59, 60, 61,  8, 17, 26, 35, 44, 53, 71, 80, 69, 70, 78, 79}, // 6,8
+  {64, 65, 66, 67, 68, 69, 70, 71,  0,  9, 18, 27, 36, 45, 54, 72, 55, 56, 73, 74}, // 7,0
+  {63, 65, 66, 67, 68, 69, 70, 71,  1, 10, 19, 28, 37, 46, 55, 73, 54, 56, 72, 74}, // 7,1
+  {63, 64, 66, 67, 68, 69, 70, 71,  2, 11, 20, 29, 38, 47, 56, 74, 54, 55, 72, 73}, // 7,2
+  {63, 64, 65, 67, 68, 69, 70, 71,  3, 12, 21, 30, 39, 48, 57, 75, 58, 59, 76, 77}, // 7,3
+  {63, 64, 65, 66, 68, 69, 70, 71,  4, 13, 22, 31, 40, 49, 58, 76, 57, 59, 75, 77}, // 7,4
+  {63, 64, 65, 66, 67, 69, 70, 71,  5, 14, 23, 32, 41, 50, 59, 77, 57, 58, 75, 76}, // 7,5
+  {63, 64, 65, 66, 67, 68, 70, 71,  6, 15, 24, 33, 42, 51, 60, 78, 61, 62, 79, 80}, // 7,6
+  {63, 64, 65, 66, 67, 68, 69, 71,  7, 16, 25, 34, 43, 52, 61, 79, 60, 62, 78, 80}, // 7,7
+  {63, 64, 65, 66, 67, 68, 69, 70,  8, 17, 26, 35, 44, 53, 62, 80, 60, 61, 78, 79}, // 7,8
+  {73, 74, 75, 76, 77, 78, 79, 80,  0,  9, 18, 27, 36, 45, 54, 63, 55, 56, 64, 65}, // 8,0
+  {72, 74, 75, 76, 77, 78, 79, 80,  1, 10, 19, 28, 37, 46, 55, 64, 54, 56, 63, 65}, // 8,1
+  {72, 73, 75, 76, 77, 78, 79, 80,  2, 11, 20, 29, 38, 47, 56, 65, 54, 55, 63, 64}, // 8,2
+  {72, 73, 74, 76, 77, 78, 79, 80,  3, 12, 21, 30, 39, 48, 57, 66, 58, 59, 67, 68}, // 8,3
+  {72, 73, 74, 75, 77, 78, 79, 80,  4, 13, 22, 31, 40, 49, 58, 67, 57, 59, 66, 68}, // 8,4
+  {72, 73, 74, 75, 76, 78, 79, 80,  5, 14, 23, 32, 41, 50, 59, 68, 57, 58, 66, 67}, // 8,5
+  {72, 73, 74, 75, 76, 77, 79, 80,  6, 15, 24, 33, 42, 51, 60, 69, 61, 62, 70, 71}, // 8,6
+  {72, 73, 74, 75, 76, 77, 78, 80,  7, 16, 25, 34, 43, 52, 61, 70, 60, 62, 69, 71}, // 8,7
+  {72, 73, 74, 75, 76, 77, 78, 79,  8, 17, 26, 35, 44, 53, 62, 71, 60, 61, 69, 70}, // 8,8
+};
+
+// Cells of each house: rows 0-8, columns 9-17, blocks 18-26
+const uint8_t houses[N_HOUSES][HOUSE_SZ] = {
+  { 0,  1,  2,  3,  4,  5,  6,  7,  8},
+  { 9, 10, 11, 12, 13, 14, 15, 16, 17},
+  {18, 19, 20, 21, 22, 23, 24, 25, 26},
+  {27, 28, 29, 30, 31, 32, 33, 34, 35},
+  {36, 37, 38, 39, 40, 41, 42, 43, 44},
+  {45, 46, 47, 48, 49, 50, 51, 52, 53},
+  {54, 55, 56, 57, 58, 59, 60, 61, 62},
+  {63, 64, 65, 66, 67, 68, 69, 70, 71},
+  {72, 73, 74, 75, 76, 77, 78, 79, 80},
+  { 0,  9, 18, 27, 36, 45, 54, 63, 72},
+  { 1, 10, 19, 28, 37, 46, 55, 64, 73},
+  { 2, 11, 20, 29, 38, 47, 56, 65, 74},
+  { 3, 12, 21, 30, 39, 48, 57, 66, 75},
+  { 4, 13, 22, 31, 40, 49, 58, 67, 76},
+  { 5, 14, 23, 32, 41, 50, 59, 68, 77},
+  { 6, 15, 24, 33, 42, 51, 60, 69, 78},
+  { 7, 16, 25, 34, 43, 52, 61, 70, 79},
+  { 8, 17, 26, 35, 44, 53, 62, 71, 80},
+  { 0,  1,  2,  9, 10, 11, 18, 19, 20},
+  { 3,  4,  5, 12, 13, 14, 21, 22, 23},
+  { 6,  7,  8, 15, 16, 17, 24, 25, 26},
+  {27, 28, 29, 36, 37, 38, 45, 46, 47},
+  {30, 31, 32, 39, 40, 41, 48, 49, 50},
+  {33, 34, 35, 42, 43, 44, 51, 52, 53},
+  {54, 55, 56, 63, 64, 65, 72, 73, 74},
+  {57, 58, 59, 66, 67, 68, 75, 76, 77},
+  {60, 61, 62, 69, 70, 71, 78, 79, 80},
+};
 
 void copy_cells(uint16_t src[HOUSE_SZ][HOUSE_SZ], uint16_t dst[HOUSE_SZ][HOUSE_SZ]) {
+  INSTR_ADD(copy_bytes, HOUSE_SZ * HOUSE_SZ * sizeof(uint16_t));
   for (int i = 0; i < HOUSE_SZ; i++) {
     for (int j = 0; j < HOUSE_SZ; j++) {
       dst[i][j] = src[i][j];
@@ -28,6 +145,106 @@ void copy_cells(uint16_t src[HOUSE_SZ][HOUSE_SZ], uint16_t dst[HOUSE_SZ][HOUSE_S
   }
 }
 
+// Remove candidates not in keep from cell n, queueing it on ring if it is
+// left with a single candidate and recording its old value on trail if any
+// Returns -1 if cell is left with no candidates
+static inline int eliminate(uint16_t *flat, int n, uint16_t keep,
+    uint8_t *ring, unsigned *tail, struct trail *trail) {
+  uint16_t old = flat[n];
+  if (!old)
+    return 0;
+
+  flat[n] &= keep;
+  if (flat[n] != old) {
+    INSTR_INC(peer_eliminations);
+    if (trail)
+      trail_push(trail, n, old);
+    if (!flat[n])
+      return -1;
+    if (!(flat[n] & (flat[n] - 1)))
+      ring[(*tail)++ & (PROP_RING_SZ - 1)] = n;
+  }
+  return 0;
+}
+
+// Eliminate value of solved cell n from its peers, along with the values
+// of any peers it leaves solved. Pending solved cells are kept on a ring
+// rather than recursed into. Inlined into the public variants below so the
+// NULL checks fold away.
+static inline int propagate_cell(uint16_t *flat, uint16_t *solved,
+    struct trail *trail, int n) {
+  uint8_t ring[PROP_RING_SZ];
+  unsigned head = 0;
+  unsigned tail = 0;
+  ring[tail++] = n;
+
+  while (head != tail) {
+    n = ring[head++ & (PROP_RING_SZ - 1)];
+    uint16_t elim = ~flat[n];
+    if (solved) {
+      solved[n] = flat[n];
+      flat[n] = 0;
+    }
+
+    for (int p = 0; p < N_PEERS; p++) {
+      if (eliminate(flat, peers[n][p], elim, ring, &tail, trail))
+        return -1;
+    }
+  }
+  return 0;
+}
+
+// Propagate solved cell i,j. If solved is non-NULL, each solved cell is
+// moved there and cleared from cells (as in ts.c).
+// Returns -1 as soon as any cell is left with no candidates, 0 otherwise
+int propagate(uint16_t cells[HOUSE_SZ][HOUSE_SZ], uint16_t solved[HOUSE_SZ][HOUSE_SZ],
+    int i, int j) {
+  INSTR_INC(propagate_calls);
+  INSTR_CLOCK(start);
+  int ret = propagate_cell(&cells[0][0], solved ? &solved[0][0] : NULL, NULL,
+      i * HOUSE_SZ + j);
+  INSTR_ELAPSED(propagate_ns, start);
+  return ret;
+}
+
+// Propagate solved cell i,j, recording every changed cell on trail so the
+// changes can be reverted with trail_undo
+int propagate_trail(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct trail *trail, int i, int j) {
+  INSTR_INC(propagate_calls);
+  INSTR_CLOCK(start);
+  int ret = propagate_cell(&cells[0][0], NULL, trail, i * HOUSE_SZ + j);
+  INSTR_ELAPSED(propagate_ns, start);
+  return ret;
+}
+
+// Revert cells changed since trail was mark entries long
+void trail_undo(struct trail *trail, uint16_t cells[HOUSE_SZ][HOUSE_SZ], int mark) {
+  uint16_t *flat = &cells[0][0];
+  while (trail->size > mark) {
+    struct trail_entry *entry = &trail->entries[--trail->size];
+    flat[entry->cell] = entry->old;
+  }
+}
+
+// Check if board is solved - every cell has one candidate and each house
+// has one instance of each number
+int is_solved(const uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  const uint16_t *flat = &cells[0][0];
+  for (int h = 0; h < N_HOUSES; h++) {
+    uint16_t seen = 0;
+    for (int k = 0; k < HOUSE_SZ; k++) {
+      uint16_t c = flat[houses[h][k]];
+      if ((c & (c - 1)) || (c & seen))
+        return 0;
+      seen |= c;
+    }
+
+    if (seen != (1 << HOUSE_SZ) - 1)
+      return 0;
+  }
+  return 1;
+}
+
 int cells_str(uint16_t cells[HOUSE_SZ][HOUSE_SZ], char *buf, int n) {
   if (n < (HOUSE_SZ + 1) * HOUSE_SZ) {
     LOG("too short");
@@ -41,11 +258,8 @@ int cells_str(uint16_t cells[HOUSE_SZ][HOUSE_SZ], char *buf, int n) {
       if (j == HOUSE_SZ) {
         buf[k++] = '\n';
       }
-      else if (!(cells[i][j] & (cells[i][j] - 1))) {
-        int x = 1;
-        while (cells[i][j] >> x != 0)
-          x++;
-        buf[k++] = x + '0';
+      else if (cells[i][j] && !(cells[i][j] & (cells[i][j] - 1))) {
+        buf[k++] = bit_index(cells[i][j]) + '1';
       }
       else {
         buf[k++] = '0';
@@ -56,6 +270,30 @@ int cells_str(uint16_t cells[HOUSE_SZ][HOUSE_SZ], char *buf, int n) {
   return k;
 }
 
+// Single-line form of cells_str: 81 digits and a newline
+int cells_line_str(uint16_t cells[HOUSE_SZ][HOUSE_SZ], char *buf, int n) {
+  if (n < N_CELLS + 2) {
+    LOG("too short");
+    errno = EINVAL;
+    return -1;
+  }
+
+  int k = 0;
+  for (int i = 0; i < HOUSE_SZ; i++) {
+    for (int j = 0; j < HOUSE_SZ; j++) {
+      if (cells[i][j] && !(cells[i][j] & (cells[i][j] - 1))) {
+        buf[k++] = bit_index(cells[i][j]) + '1';
+      }
+      else {
+        buf[k++] = '0';
+      }
+    }
+  }
+  buf[k++] = '\n';
+  buf[k] = '\0';
+  return k;
+}
+
 int vec_str(const uint16_t vec, char *buf, int n) {
   if (n < HOUSE_SZ + 1) {
     errno = EINVAL;
@@ -71,6 +309,288 @@ int vec_str(const uint16_t vec, char *buf, int n) {
   return i;
 }
 
+// Candidates for each ASCII digit: '0' is an empty cell with all candidates
+static const uint16_t digit_cells[HOUSE_SZ + 1] = {
+  0x1ff, 1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7, 1 << 8
+};
+
+static int parse_cells_scalar(const char *digits, int n, uint16_t *cells) {
+  for (int k = 0; k < n; k++) {
+    unsigned d = (unsigned char) digits[k] - '0';
+    if (d > HOUSE_SZ)
+      return k;
+    cells[k] = digit_cells[d];
+  }
+  return -1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// Parse 16 digits at a time: subtract '0', reject lanes outside 0-9, then
+// look up the low & high bytes of each candidate vector with pshufb and
+// interleave them into 16-bit cells
+__attribute__((target("ssse3")))
+static int parse_cells_ssse3(const char *digits, int n, uint16_t *cells) {
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i nine = _mm_set1_epi8(HOUSE_SZ);
+  const __m128i lo_table = _mm_setr_epi8((char) 0xff, 1 << 0, 1 << 1, 1 << 2, 1 << 3,
+      1 << 4, 1 << 5, 1 << 6, (char) (1 << 7), 0, 0, 0, 0, 0, 0, 0);
+  const __m128i hi_table = _mm_setr_epi8(1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0);
+
+  int k = 0;
+  for (; k + 16 <= n; k += 16) {
+    __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) (digits + k)), zero);
+    __m128i bad = _mm_or_si128(_mm_cmpgt_epi8(d, nine), _mm_cmplt_epi8(d, _mm_setzero_si128()));
+    if (_mm_movemask_epi8(bad))
+      return k + __builtin_ctz(_mm_movemask_epi8(bad));
+
+    __m128i lo = _mm_shuffle_epi8(lo_table, d);
+    __m128i hi = _mm_shuffle_epi8(hi_table, d);
+    _mm_storeu_si128((__m128i *) (cells + k), _mm_unpacklo_epi8(lo, hi));
+    _mm_storeu_si128((__m128i *) (cells + k + 8), _mm_unpackhi_epi8(lo, hi));
+  }
+
+  int ret = parse_cells_scalar(digits + k, n - k, cells + k);
+  return ret < 0 ? ret : k + ret;
+}
+#endif
+
+// Convert n ASCII digits to candidate bitvectors
+// Returns index of first invalid digit, or -1 if all are valid
+int parse_cells(const char *digits, int n, uint16_t *cells) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (n >= 16 && __builtin_cpu_supports("ssse3"))
+    return parse_cells_ssse3(digits, n, cells);
+#endif
+  return parse_cells_scalar(digits, n, cells);
+}
+
+static uint32_t get_u32(const char *p) {
+  const unsigned char *b = (const unsigned char *) p;
+  return b[0] | b[1] << 8 | b[2] << 16 | (uint32_t) b[3] << 24;
+}
+
+// If the corpus read in is packed, check its header and level table and
+// skip to its first puzzle
+// Returns nonzero if it is packed but malformed
+static int packed_open(struct reader *reader) {
+  if (reader->size < PACKED_HEADER_SZ || memcmp(reader->data, PACKED_MAGIC, 4))
+    return 0;
+
+  if (reader->data[4] != PACKED_VERSION) {
+    fprintf(stderr, "Unknown packed corpus version %d\n", reader->data[4]);
+    return 1;
+  }
+  reader->n_levels = (unsigned char) reader->data[5];
+  reader->n_packed = get_u32(reader->data + 8);
+  reader->levels = reader->data + PACKED_HEADER_SZ;
+  reader->pos = PACKED_HEADER_SZ + reader->n_levels * PACKED_LEVEL_SZ;
+  if (reader->size < reader->pos + reader->n_packed * PACKED_PUZZLE_SZ) {
+    fprintf(stderr, "Truncated packed corpus\n");
+    return 1;
+  }
+  for (int l = 0; l < reader->n_levels; l++) {
+    if (reader->levels[l * PACKED_LEVEL_SZ + PACKED_TAG_SZ - 1]) {
+      fprintf(stderr, "Malformed packed corpus level %d\n", l);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Open corpus at path ("-" for stdin) for reading with reader_next
+int reader_open(struct reader *reader, const char *path) {
+  reader->data = NULL;
+  reader->size = 0;
+  reader->pos = 0;
+  reader->mapped = 0;
+  reader->levels = NULL;
+  reader->n_levels = 0;
+  reader->n_packed = 0;
+  reader->n_read = 0;
+
+  int fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+  if (fd < 0) {
+    perror("open");
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    reader->size = st.st_size;
+    if (reader->size) {
+      void *data = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        perror("mmap");
+        if (fd != STDIN_FILENO)
+          close(fd);
+        return -1;
+      }
+      madvise(data, reader->size, MADV_SEQUENTIAL);
+      reader->data = data;
+      reader->mapped = 1;
+    }
+  } else {
+    // Pipes can't be mapped, so read the whole stream in instead
+    size_t cap = 1 << 16;
+    char *buf = malloc(cap);
+    ssize_t ret = 0;
+    while (buf && (ret = read(fd, buf + reader->size, cap - reader->size)) > 0) {
+      reader->size += ret;
+      if (reader->size == cap) {
+        char *grown = realloc(buf, cap * 2);
+        if (!grown)
+          break;
+        buf = grown;
+        cap *= 2;
+      }
+    }
+    reader->data = buf;
+    // The buffer is only left full if it could not grow
+    if (!buf || reader->size == cap || ret < 0) {
+      perror(ret < 0 ? "read" : "malloc");
+      reader_close(reader);
+      if (fd != STDIN_FILENO)
+        close(fd);
+      return -1;
+    }
+  }
+
+  if (fd != STDIN_FILENO)
+    close(fd);
+  if (packed_open(reader)) {
+    reader_close(reader);
+    return -1;
+  }
+  return 0;
+}
+
+// Find first whitespace-separated field of length n in line [p, eol)
+static const char *find_field(const char *p, const char *eol, int n) {
+  while (p < eol) {
+    while (p < eol && isspace((unsigned char) *p))
+      p++;
+
+    const char *field = p;
+    while (p < eol && !isspace((unsigned char) *p))
+      p++;
+
+    if (p - field == n)
+      return field;
+  }
+  return NULL;
+}
+
+// Parse next puzzle in corpus into cells, with no candidates eliminated
+// Returns 1 if a puzzle was read, 0 at end of corpus and -1 if the next
+// puzzle is malformed (it is skipped, so reading may continue)
+int reader_next(struct reader *reader, uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  if (reader->levels) {
+    if (reader->n_read == reader->n_packed)
+      return 0;
+
+    // Two cells per byte, so no digits to parse
+    const unsigned char *b = (const unsigned char *) reader->data + reader->pos;
+    uint16_t *cell = &cells[0][0];
+    int bad = -1;
+    for (int n = 0; n < N_CELLS; n++) {
+      int d = (b[n >> 1] >> ((n & 1) << 2)) & 0xf;
+      cell[n] = d ? 1 << (d - 1) : (1 << HOUSE_SZ) - 1;
+      if (d > HOUSE_SZ)
+        bad = d;
+    }
+    reader->pos += PACKED_PUZZLE_SZ;
+    reader->n_read++;
+    if (bad >= 0) {
+      fprintf(stderr, "Invalid packed digit: %d\n", bad);
+      return -1;
+    }
+    return 1;
+  }
+
+  const char *p = reader->data + reader->pos;
+  const char *end = reader->data + reader->size;
+
+  while (p < end) {
+    if (isspace((unsigned char) *p)) {
+      p++;
+      continue;
+    }
+
+    const char *eol = memchr(p, '\n', end - p);
+    if (!eol)
+      eol = end;
+
+    int bad = -1;
+    if (eol - p == HOUSE_SZ) {
+      // Nine lines of nine digits
+      for (int i = 0; i < HOUSE_SZ; i++) {
+        eol = memchr(p, '\n', end - p);
+        if (!eol)
+          eol = end;
+
+        if (eol - p != HOUSE_SZ) {
+          LOG("Malformed row %d", i);
+          reader->pos = (eol < end ? eol + 1 : end) - reader->data;
+          return -1;
+        }
+
+        int ret = parse_cells(p, HOUSE_SZ, cells[i]);
+        if (ret >= 0 && bad < 0)
+          bad = p[ret];
+        p = eol < end ? eol + 1 : end;
+      }
+    } else {
+      // One puzzle per line
+      const char *field = find_field(p, eol, N_CELLS);
+      p = eol < end ? eol + 1 : end;
+      if (!field)
+        continue;
+
+      int ret = parse_cells(field, N_CELLS, &cells[0][0]);
+      if (ret >= 0)
+        bad = field[ret];
+    }
+
+    reader->pos = p - reader->data;
+    if (bad >= 0) {
+      fprintf(stderr, "Invalid digit: %d\n", bad);
+      return -1;
+    }
+    return 1;
+  }
+
+  reader->pos = reader->size;
+  return 0;
+}
+
+// Tag of the level of the puzzle last read from a packed corpus, or NULL if
+// the corpus is not packed or the puzzle is in no level
+const char *reader_level(const struct reader *reader) {
+  long k = reader->n_read - 1;
+  for (int l = 0; l < reader->n_levels; l++) {
+    const char *level = reader->levels + l * PACKED_LEVEL_SZ;
+    long first = get_u32(level + PACKED_TAG_SZ);
+    if (k >= first && k < first + (long) get_u32(level + PACKED_TAG_SZ + 4))
+      return level;
+  }
+  return NULL;
+}
+
+void reader_close(struct reader *reader) {
+  if (reader->mapped)
+    munmap((void *) reader->data, reader->size);
+  else
+    free((void *) reader->data);
+  reader->data = NULL;
+  reader->size = 0;
+  reader->pos = 0;
+  reader->mapped = 0;
+  reader->levels = NULL;
+  reader->n_levels = 0;
+}
+
 void stack_init(struct stack *stack) {
   stack->head = NULL;
 }
@@ -148,6 +668,89 @@ int queue_is_empty(struct queue *queue) {
   return queue->head == NULL;
 }
 
+void astack_init(struct astack *stack, int size) {
+  stack->array_n = size > 0 ? size : 1;
+  stack->array = malloc(sizeof(void *) * stack->array_n);
+  stack->size = 0;
+}
+
+void astack_destroy(struct astack *stack) {
+  free(stack->array);
+  stack->array = NULL;
+  stack->size = 0;
+  stack->array_n = 0;
+}
+
+void astack_reset(struct astack *stack) {
+  stack->size = 0;
+}
+
+void astack_push(struct astack *stack, void *datum) {
+  if (stack->size == stack->array_n) {
+    stack->array_n *= 2;
+    stack->array = realloc(stack->array, sizeof(void *) * stack->array_n);
+  }
+  stack->array[stack->size++] = datum;
+}
+
+void *astack_pop(struct astack *stack) {
+  if (!stack->size)
+    return NULL;
+  return stack->array[--stack->size];
+}
+
+int astack_is_empty(struct astack *stack) {
+  return stack->size == 0;
+}
+
+void aqueue_init(struct aqueue *queue, int size) {
+  queue->array_n = 1;
+  while (queue->array_n < size)
+    queue->array_n <<= 1;
+  queue->array = malloc(sizeof(void *) * queue->array_n);
+  queue->head = 0;
+  queue->size = 0;
+}
+
+void aqueue_destroy(struct aqueue *queue) {
+  free(queue->array);
+  queue->array = NULL;
+  queue->head = 0;
+  queue->size = 0;
+  queue->array_n = 0;
+}
+
+void aqueue_reset(struct aqueue *queue) {
+  queue->head = 0;
+  queue->size = 0;
+}
+
+void aqueue_put(struct aqueue *queue, void *datum) {
+  if (queue->size == queue->array_n) {
+    // Unwrap into doubled array: data from head to end of array moves up
+    queue->array = realloc(queue->array, sizeof(void *) * queue->array_n * 2);
+    for (int i = 0; i < queue->head; i++) {
+      queue->array[queue->array_n + i] = queue->array[i];
+    }
+    queue->array_n *= 2;
+  }
+  queue->array[(queue->head + queue->size++) & (queue->array_n - 1)] = datum;
+}
+
+void *aqueue_get(struct aqueue *queue) {
+  if (!queue->size)
+    return NULL;
+
+  void *datum = queue->array[queue->head];
+  queue->head = (queue->head + 1) & (queue->array_n - 1);
+  queue->size--;
+  return datum;
+}
+
+int aqueue_is_empty(struct aqueue *queue) {
+  return queue->size == 0;
+}
+
 void pq_init(struct pq *pq, int (*priority)(void *), int size) {
   pq->priority = priority;
   pq->size = 0;
@@ -202,6 +805,7 @@ static void pq_change_key_at(struct pq *pq, int i) {
 }
 
 int pq_insert(struct pq *pq, void *datum) {
+  INSTR_INC(pq_ops);
   if (pq->size == pq->array_n)
     return 1;
 
@@ -215,6 +819,7 @@ int pq_insert(struct pq *pq, void *datum) {
 }
 
 void *pq_extract_max(struct pq *pq) {
+  INSTR_INC(pq_ops);
   void *to_return = pq->array[0];
   pq->array[0] = pq->array[pq->size - 1];
   pq->size--;
@@ -224,6 +829,7 @@ void *pq_extract_max(struct pq *pq) {
 
 
 void pq_change_key(struct pq *pq, void *datum) {
+  INSTR_INC(pq_ops);
   int i = 0;
   for (; i < pq->size; i++) {
     if (pq->array[i] == datum)
@@ -240,4 +846,151 @@ int pq_is_empty(struct pq *pq) {
   return pq->size == 0;
 }
 
+void ipq_init(struct ipq *pq, int n) {
+  ipq_init_buf(pq, n, malloc(sizeof(int) * n * 3));
+}
+
+// Initialize pq for keys 0 to n-1 in caller-owned storage of 3 * n ints,
+// so a queue can live on the stack. Do not ipq_destroy it.
+void ipq_init_buf(struct ipq *pq, int n, int *buf) {
+  pq->heap = buf;
+  pq->pos = pq->heap + n;
+  pq->priority = pq->pos + n;
+  pq->size = 0;
+  pq->array_n = n;
+  for (int k = 0; k < n; k++) {
+    pq->pos[k] = -1;
+  }
+}
+
+void ipq_destroy(struct ipq *pq) {
+  free(pq->heap);
+  pq->heap = NULL;
+  pq->pos = NULL;
+  pq->priority = NULL;
+  pq->size = 0;
+  pq->array_n = 0;
+}
+
+// Place key in heap slot i, updating its position
+static inline void ipq_set(struct ipq *pq, int i, int key) {
+  pq->heap[i] = key;
+  pq->pos[key] = i;
+}
+
+static void ipq_sift_up(struct ipq *pq, int i) {
+  int key = pq->heap[i];
+  int priority = pq->priority[key];
+  while (i > 0 && priority > pq->priority[pq->heap[(i - 1) / 2]]) {
+    ipq_set(pq, i, pq->heap[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+  ipq_set(pq, i, key);
+}
+
+static void ipq_sift_down(struct ipq *pq, int i) {
+  int key = pq->heap[i];
+  int priority = pq->priority[key];
+  while (i * 2 + 1 < pq->size) {
+    int child = i * 2 + 1;
+    if (child + 1 < pq->size && pq->priority[pq->heap[child + 1]] > pq->priority[pq->heap[child]])
+      child++;
+
+    if (pq->priority[pq->heap[child]] <= priority)
+      break;
+
+    ipq_set(pq, i, pq->heap[child]);
+    i = child;
+  }
+  ipq_set(pq, i, key);
+}
+
+// Returns nonzero if key is out of range or already queued
+int ipq_insert(struct ipq *pq, int key, int priority) {
+  INSTR_INC(pq_ops);
+  if (key < 0 || key >= pq->array_n || pq->pos[key] >= 0)
+    return 1;
+
+  pq->priority[key] = priority;
+  ipq_set(pq, pq->size, key);
+  pq->size++;
+  ipq_sift_up(pq, pq->size - 1);
+  return 0;
+}
+
+// Returns key with the highest priority, or -1 if empty
+int ipq_extract_max(struct ipq *pq) {
+  INSTR_INC(pq_ops);
+  if (!pq->size)
+    return -1;
+
+  int key = pq->heap[0];
+  pq->pos[key] = -1;
+  pq->size--;
+  if (pq->size) {
+    ipq_set(pq, 0, pq->heap[pq->size]);
+    ipq_sift_down(pq, 0);
+  }
+  return key;
+}
+
+void ipq_change_key(struct ipq *pq, int key, int priority) {
+  INSTR_INC(pq_ops);
+  int i = pq->pos[key];
+  if (i < 0)
+    return;
+
+  int old = pq->priority[key];
+  pq->priority[key] = priority;
+  if (priority > old)
+    ipq_sift_up(pq, i);
+  else if (priority < old)
+    ipq_sift_down(pq, i);
+}
+
+int ipq_contains(struct ipq *pq, int key) {
+  return pq->pos[key] >= 0;
+}
+
+int ipq_is_empty(struct ipq *pq) {
+  return pq->size == 0;
+}
+
+#ifdef INSTRUMENT
+__thread struct instr instr;
+
+long long instr_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Reset this thread's counters for a solve of cells, as given
+void instr_begin(uint16_t cells[HOUSE_SZ][HOUSE_SZ]) {
+  memset(&instr, 0, sizeof(instr));
+  cells_line_str(cells, instr.puzzle, sizeof(instr.puzzle));
+  instr.start_ns = instr_now();
+}
+
+// Write this thread's counters for the solve since instr_begin to stderr as
+// one JSON line, with the solver, its result & its backtracks
+void instr_end(const char *solver, int ret, int backtracks) {
+  long long ns = instr_now() - instr.start_ns;
+  char line[1024];
+  snprintf(line, sizeof(line),
+      "{\"solver\": \"%s\", \"puzzle\": \"%.*s\", \"ret\": %d, \"backtracks\": %d, "
+      "\"ns\": %lld, \"propagate_ns\": %lld, \"strategy_ns\": %lld, "
+      "\"remove_candidate\": %ld, \"propagate_calls\": %ld, \"peer_eliminations\": %ld, "
+      "\"transforms_pushed\": %ld, \"transforms_popped\": %ld, \"max_depth\": %d, "
+      "\"copy_bytes\": %ld, \"pq_ops\": %ld, \"strategy_calls\": %ld, "
+      "\"strategy_hits\": %ld}\n",
+      solver, N_CELLS, instr.puzzle, ret, backtracks, ns, instr.propagate_ns,
+      instr.strategy_ns, instr.remove_candidate, instr.propagate_calls,
+      instr.peer_eliminations, instr.transforms_pushed, instr.transforms_popped,
+      instr.max_depth, instr.copy_bytes, instr.pq_ops, instr.strategy_calls,
+      instr.strategy_hits);
+  fputs(line, stderr);
+}
+#endif
+
 /* vim:set ts=2 sw=2 et: */
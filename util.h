@@ -4,23 +4,152 @@
  * @author: Grace-H
  */
 
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stddef.h>
 #include <stdint.h>
 
 #define HOUSE_SZ 9 // Cells in one house
 #define BLK_WIDTH 3 // Cells in intersection between houses & width of one block
 #define N_CELLS 81
+#define N_HOUSES 27 // Rows, columns & blocks
+#define N_PEERS 20  // Cells sharing a house with any one cell
+#define PROP_RING_SZ 128 // Power of 2 > N_CELLS: a cell is queued at most once per propagate
+#define TRAIL_SZ (N_CELLS * HOUSE_SZ) // Each change removes at least one candidate
 
 #define LOG(format, ...) fprintf(stderr, "%s(%d):\t" format "\n",       \
     __func__, __LINE__, ##__VA_ARGS__)
 
+// Peer & house tables, indexed by cell number i * HOUSE_SZ + j
+extern const uint8_t peers[N_CELLS][N_PEERS];
+extern const uint8_t houses[N_HOUSES][HOUSE_SZ];
+
+// Undo trail: cells changed since the start of a search, with their former
+// candidates, so a search can revert to a choice point without copying grids
+struct trail_entry {
+  uint8_t cell;
+  uint16_t old;
+};
+
+struct trail {
+  struct trail_entry entries[TRAIL_SZ];
+  int size;
+};
+
+static inline void trail_push(struct trail *trail, int cell, uint16_t old) {
+  trail->entries[trail->size].cell = cell;
+  trail->entries[trail->size].old = old;
+  trail->size++;
+}
+
+// Bit primitives for candidate vectors
+// Compilers with GCC builtins emit popcnt/tzcnt where the target has them
+// (e.g. with -mpopcnt -mbmi or -march=native); otherwise portable fallbacks
+#if defined(__GNUC__)
+static inline int bit_count(uint16_t n) {
+  return __builtin_popcount(n);
+}
+
+// Index of lowest set bit; n must be nonzero
+static inline int bit_index(uint16_t n) {
+  return __builtin_ctz(n);
+}
+
+static inline int bit_index64(uint64_t n) {
+  return __builtin_ctzll(n);
+}
+
+static inline int bit_count64(uint64_t n) {
+  return __builtin_popcountll(n);
+}
+#else
+static inline int bit_count(uint16_t n) {
+  n = n - ((n >> 1) & 0x5555);
+  n = (n & 0x3333) + ((n >> 2) & 0x3333);
+  n = (n + (n >> 4)) & 0x0f0f;
+  return (n + (n >> 8)) & 0x1f;
+}
+
+static inline int bit_index(uint16_t n) {
+  int i = 0;
+  while (!(n & 1)) {
+    n >>= 1;
+    i++;
+  }
+  return i;
+}
+
+static inline int bit_index64(uint64_t n) {
+  int i = 0;
+  while (!(n & 1)) {
+    n >>= 1;
+    i++;
+  }
+  return i;
+}
+
+static inline int bit_count64(uint64_t n) {
+  return bit_count(n) + bit_count(n >> 16) + bit_count(n >> 32) + bit_count(n >> 48);
+}
+#endif
+
+// Lowest set bit of n, e.g. the first candidate to try
+static inline uint16_t bit_lowest(uint16_t n) {
+  return n & -n;
+}
+
 // Grid & vector operations
-int bit_count(const uint16_t n);
 void copy_cells(uint16_t src[HOUSE_SZ][HOUSE_SZ], uint16_t dst[HOUSE_SZ][HOUSE_SZ]);
+int propagate(uint16_t cells[HOUSE_SZ][HOUSE_SZ], uint16_t solved[HOUSE_SZ][HOUSE_SZ],
+    int i, int j);
+int propagate_trail(uint16_t cells[HOUSE_SZ][HOUSE_SZ], struct trail *trail, int i, int j);
+void trail_undo(struct trail *trail, uint16_t cells[HOUSE_SZ][HOUSE_SZ], int mark);
+int is_solved(const uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
 
 // toString functions
 int cells_str(uint16_t cells[HOUSE_SZ][HOUSE_SZ], char *buf, int n);
+int cells_line_str(uint16_t cells[HOUSE_SZ][HOUSE_SZ], char *buf, int n);
 int vec_str(const uint16_t vec, char *buf, int n);
 
+// Packed corpus, as written by tests/pack.py. All integers are little-endian.
+//   header: magic, version (1 byte), level count (1), reserved (2),
+//           puzzle count (4)
+//   levels: per level a NUL-padded tag such as "se1_2", then its first
+//           puzzle and puzzle count (4 each); levels are contiguous, in order
+//   puzzles: 41 bytes each, cell n in the low (even n) or high (odd n)
+//           nibble of byte n / 2, 0 for empty or the digit
+#define PACKED_MAGIC "SDKP"
+#define PACKED_VERSION 1
+#define PACKED_HEADER_SZ 12
+#define PACKED_TAG_SZ 12
+#define PACKED_LEVEL_SZ (PACKED_TAG_SZ + 8)
+#define PACKED_PUZZLE_SZ ((N_CELLS + 1) / 2)
+
+// Puzzle reader
+// Maps a corpus and parses puzzles straight from the mapped bytes. A corpus
+// holds puzzles either as nine lines of nine digits (one per file in
+// tests/), as one 81-digit puzzle per line, bare or in the Sudoku
+// Exchange format (hash, puzzle, clue count, rating), or packed as above.
+// '0' is an empty cell.
+struct reader {
+  const char *data;   // Contents of corpus
+  size_t size;
+  size_t pos;         // Offset of next unread byte
+  int mapped;         // Nonzero if data is mmap'd, zero if read onto heap
+  const char *levels; // Packed corpus: level table, else NULL
+  int n_levels;
+  long n_packed;      // Packed corpus: puzzles, and puzzles read so far
+  long n_read;
+};
+
+int reader_open(struct reader *reader, const char *path);
+int reader_next(struct reader *reader, uint16_t cells[HOUSE_SZ][HOUSE_SZ]);
+const char *reader_level(const struct reader *reader);
+void reader_close(struct reader *reader);
+
+int parse_cells(const char *digits, int n, uint16_t *cells);
+
 // Nodes for data structures
 struct node {
 	struct node *next;
@@ -52,6 +181,39 @@ void queue_put(struct queue *queue, void *datum);
 void *queue_get(struct queue *queue);
 int queue_is_empty(struct queue *queue);
 
+// Array-backed stack & queue
+// Storage grows by doubling and is kept on pop & reset, so once a stack or
+// queue has reached its working size, push & pop never allocate. Reset to
+// reuse one across a batch of puzzles.
+struct astack {
+  void **array;
+  int size;
+  int array_n;
+};
+
+void astack_init(struct astack *stack, int size);
+void astack_destroy(struct astack *stack);
+void astack_reset(struct astack *stack);
+
+void astack_push(struct astack *stack, void *datum);
+void *astack_pop(struct astack *stack);
+int astack_is_empty(struct astack *stack);
+
+struct aqueue {
+  void **array;
+  int head;     // Index of next datum to get
+  int size;
+  int array_n;  // Power of 2
+};
+
+void aqueue_init(struct aqueue *queue, int size);
+void aqueue_destroy(struct aqueue *queue);
+void aqueue_reset(struct aqueue *queue);
+
+void aqueue_put(struct aqueue *queue, void *datum);
+void *aqueue_get(struct aqueue *queue);
+int aqueue_is_empty(struct aqueue *queue);
+
 // Priority Queue
 struct pq {
   int (*priority)(void *);
@@ -68,4 +230,27 @@ void *pq_extract_max(struct pq *pq);
 void pq_change_key(struct pq *pq, void *datum);
 int pq_is_empty(struct pq *pq);
 
+// Indexed Priority Queue
+// Max-heap of keys 0 to n-1 with priorities stored inline. pos maps each key
+// to its heap slot, so keys can be found & reprioritized in O(log n).
+struct ipq {
+  int *heap;      // Keys in heap order
+  int *pos;       // Heap slot of each key, -1 if not queued
+  int *priority;  // Priority of each key
+  int size;
+  int array_n;
+};
+
+void ipq_init(struct ipq *pq, int n);
+void ipq_init_buf(struct ipq *pq, int n, int *buf);
+void ipq_destroy(struct ipq *pq);
+
+int ipq_insert(struct ipq *pq, int key, int priority);
+int ipq_extract_max(struct ipq *pq);
+void ipq_change_key(struct ipq *pq, int key, int priority);
+int ipq_contains(struct ipq *pq, int key);
+int ipq_is_empty(struct ipq *pq);
+
+#endif
+
 /* vim:set ts=2 sw=2 et: */